@@ -1,88 +1,253 @@
 #include "NTPClient.hpp"
+#include <lwip/dns.h>
 
 const char* const NTPClient::defaultPoolServerName = "europe.pool.ntp.org";
 
-ip4_addr_t NTPClient::getPoolServerIP() const {
-	return poolServerSpecifiedByName ? ip4_addr_t{0} : poolServerIP;
+bool NTPClient::addServer(const char* name) {
+	if (serversCount == maxServers) {
+		return false;
+	}
+	Server& server = servers[serversCount++];
+	server = {};
+	server.name = name;
+	server.state = Server::State::Unresolved;
+	return true;
 }
-const char* NTPClient::getPoolServerName() const {
-	return poolServerSpecifiedByName ? poolServerName : nullptr;
+bool NTPClient::addServer(IPAddress address) {
+	if (serversCount == maxServers) {
+		return false;
+	}
+	Server& server = servers[serversCount++];
+	server = {};
+	server.address = address;
+	server.state = Server::State::Resolved;
+	return true;
 }
 
-void NTPClient::setPoolServerIP(const ip4_addr_t ip) {
-	poolServerIP = ip;
-	poolServerSpecifiedByName = false;
+void NTPClient::dnsFoundCallback(const char* name, const ip_addr_t* address, void* arg) {
+	Server& server = *static_cast<Server*>(arg);
+	if (server.state != Server::State::Resolving) {
+		return;
+	}
+	if (address) {
+		server.address = IPAddress(address);
+		server.resolvedMillis = millis();
+		server.state = Server::State::Resolved;
+	}
+	else {
+		server.state = Server::State::Failed;
+	}
 }
-void NTPClient::setPoolServerName(const char* name) {
-	poolServerName = name;
-	poolServerSpecifiedByName = true;
+
+void NTPClient::resolve(Server& server, uint32_t currentMillis) {
+	if (!server.name) {
+		return; // specified by address
+	}
+	if (server.state == Server::State::Resolved && currentMillis - server.resolvedMillis < addressLifetimeMillis) {
+		return; // cached
+	}
+	if (server.state == Server::State::Resolving) {
+		return; // still waiting from previous synchronization
+	}
+
+	ip_addr_t address;
+	server.state = Server::State::Resolving;
+	switch (dns_gethostbyname(server.name, &address, &dnsFoundCallback, &server)) {
+		case ERR_OK: // from lwIP cache
+			server.address = IPAddress(&address);
+			server.resolvedMillis = currentMillis;
+			server.state = Server::State::Resolved;
+			break;
+		case ERR_INPROGRESS: // callback will be called
+			break;
+		default:
+			server.state = Server::State::Failed;
+			break;
+	}
 }
 
-bool NTPClient::sendNTPPacket() {
+bool NTPClient::sendNTPPacket(Server& server) {
 	byte buffer[ntpPacketSize];
 	memset(buffer, 0, ntpPacketSize);
 	buffer[0] = 0b00100011; // LI, Version, Mode
 
-	if (poolServerSpecifiedByName) {
-		if (udp.beginPacket(this->poolServerName, defaultPoolServerPort) != 1)
-			return false;
-	} 
-	else {
-		if (udp.beginPacket(this->poolServerIP, defaultPoolServerPort) != 1) 
-			return false;
-	}
+	// Random-ish cookie as transmit timestamp, to match the reply with the request
+	server.cookie = (++cookieCounter << 20) ^ micros();
+	memcpy(buffer + 40, &server.cookie, sizeof(server.cookie));
 
-	if (udp.write(buffer, ntpPacketSize) < ntpPacketSize) 
+	if (udp.beginPacket(server.address, defaultPoolServerPort) != 1)
 		return false;
 
+	if (udp.write(buffer, ntpPacketSize) < ntpPacketSize)
+		return false;
+
+	server.sentMicros = micros();
 	if (udp.endPacket() != 1)
 		return false;
 
 	return true;
 }
 
-bool NTPClient::update(unsigned long timeout) {
+/// Reads 64 bits NTP timestamp (32 bits seconds since 1900 and 32 bits fraction).
+inline uint64_t readTimestamp(const byte* buffer) {
+	uint32_t seconds, fraction;
+	memcpy(&seconds, buffer, sizeof(seconds)); // could be unaligned
+	memcpy(&fraction, buffer + 4, sizeof(fraction));
+	return (static_cast<uint64_t>(ntohl(seconds)) << 32) | ntohl(fraction);
+}
+
+void NTPClient::receive() {
+	while (udp.parsePacket() > 0) {
+		const uint32_t receivedMicros = micros();
+		const uint32_t receivedMillis = millis();
+
+		byte buffer[ntpPacketSize];
+		if (udp.read(buffer, ntpPacketSize) < static_cast<int>(ntpPacketSize)) {
+			continue;
+		}
+		udp.flush();
+
+		// Find the server by the cookie echoed as origin timestamp
+		Server* server = nullptr;
+		uint8_t index;
+		for (index = 0; index < serversCount; index++) {
+			Server& s = servers[index];
+			if (s.sent && !s.answered && memcmp(buffer + 24, &s.cookie, sizeof(s.cookie)) == 0) {
+				server = &s;
+				break;
+			}
+		}
+		if (!server) {
+			continue; // stale or unexpected
+		}
+		server->answered = true;
+
+		// Validate: leap indicator not 3 (unsynchronized), mode 4 (server), sane stratum
+		const uint8_t leapIndicator = buffer[0] >> 6;
+		const uint8_t mode = buffer[0] & 0b111;
+		const uint8_t stratum = buffer[1];
+		if (leapIndicator == 3 || mode != 4 || stratum == 0 || stratum > 15) {
+			continue;
+		}
+		const uint64_t receiveTimestamp = readTimestamp(buffer + 32);
+		const uint64_t transmitTimestamp = readTimestamp(buffer + 40);
+		if (transmitTimestamp == 0 || transmitTimestamp < receiveTimestamp 
+			|| transmitTimestamp - receiveTimestamp >= (1ull << 32) // processing over a second
+		) {
+			continue;
+		}
+
+		// Round-trip delay, without time the server took to process the request
+		const uint32_t processingMicros = static_cast<uint32_t>(((transmitTimestamp - receiveTimestamp) * 1'000'000) >> 32);
+		const uint32_t roundTripMicros = receivedMicros - server->sentMicros;
+		const uint32_t delayMicros = roundTripMicros > processingMicros ? roundTripMicros - processingMicros : 0;
+		if (hasCandidate && candidate.delayMicros <= delayMicros) {
+			continue;
+		}
+
+		// Time of receiving is transmit time plus half of the delay (assuming symmetric paths)
+		const uint64_t timestamp = transmitTimestamp + ((static_cast<uint64_t>(delayMicros / 2) << 32) / 1'000'000);
+		candidate = {
+			.receivedMillis = receivedMillis,
+			.seconds = static_cast<uint32_t>(timestamp >> 32) - offsetFrom1900,
+			.fraction = static_cast<uint32_t>(timestamp),
+			.delayMicros = delayMicros,
+			.server = index,
+			.stratum = stratum,
+		};
+		hasCandidate = true;
+	}
+}
+
+void NTPClient::startSync(uint32_t timeoutMillis) {
+	if (status == Status::InProgress) {
+		return;
+	}
+	if (serversCount == 0) {
+		addServer(defaultPoolServerName);
+	}
+
 	// Flush any existing packets
 	while (udp.parsePacket() != 0) {
 		udp.flush();
 	}
 
-	if (!sendNTPPacket())
-		return false;
-
-	// Wait for response
-	int packetSize;
-	{
-		uint32_t start = millis();
-		do {
-			delay(4);
-			packetSize = udp.parsePacket();
-			if (millis() - start > timeout) {
-				return false;
-			}
+	const uint32_t currentMillis = millis();
+	for (uint8_t i = 0; i < serversCount; i++) {
+		Server& server = servers[i];
+		if (server.state == Server::State::Failed) {
+			server.state = Server::State::Unresolved; // try again
 		}
-		while (packetSize == 0);
+		server.sent = false;
+		server.answered = false;
+		resolve(server, currentMillis);
+	}
+
+	this->timeoutMillis = timeoutMillis;
+	syncStartMillis = currentMillis;
+	hasCandidate = false;
+	status = Status::InProgress;
+}
 
-		lastUpdateMillis = millis();
+NTPClient::Status NTPClient::poll() {
+	if (status != Status::InProgress) {
+		return Status::Idle;
 	}
 
-	byte buffer[ntpPacketSize];
-	udp.read(buffer, ntpPacketSize);
+	// Send requests to servers with addresses ready
+	bool waiting = false;
+	for (uint8_t i = 0; i < serversCount; i++) {
+		Server& server = servers[i];
+		switch (server.state) {
+			case Server::State::Resolved:
+				if (!server.sent) {
+					if (!sendNTPPacket(server)) {
+						server.state = Server::State::Failed;
+						break;
+					}
+					server.sent = true;
+				}
+				waiting |= !server.answered;
+				break;
+			case Server::State::Unresolved:
+			case Server::State::Resolving:
+				waiting = true;
+				break;
+			case Server::State::Failed:
+				break;
+		}
+	}
 
-	// NTP returns time since Jan 1 1900 in seconds and fraction parts, each 32 bits.
-	const uint32_t seconds = ntohl(*reinterpret_cast<const uint32_t*>(buffer + 40));
-	lastResponseSeconds = seconds - offsetFrom1900;
-	const uint64_t fraction = ntohl(*reinterpret_cast<const uint16_t*>(buffer + 44));
-	lastResponseMillis = (fraction * 1000) >> 32;
+	receive();
 
-	return true;
+	if (!waiting || millis() - syncStartMillis > timeoutMillis) {
+		// Servers not answering might have changed their addresses
+		for (uint8_t i = 0; i < serversCount; i++) {
+			Server& server = servers[i];
+			if (server.name && server.sent && !server.answered) {
+				server.state = Server::State::Unresolved;
+			}
+		}
+		return finish();
+	}
+	return Status::InProgress;
+}
+
+NTPClient::Status NTPClient::finish() {
+	status = Status::Idle;
+	if (!hasCandidate) {
+		return Status::Failed;
+	}
+
+	sample = candidate;
+	lastUpdateMillis = sample.receivedMillis;
+	lastResponseSeconds = sample.seconds;
+	lastResponseMillis = static_cast<uint16_t>((static_cast<uint64_t>(sample.fraction) * 1000) >> 32);
+	return Status::Success;
 }
 
 uint32_t NTPClient::millisSinceUpdate(const uint32_t currentMillis) const {
-	return currentMillis < lastUpdateMillis
-		? (std::numeric_limits<uint32_t>::max() - lastUpdateMillis + currentMillis)
-		: currentMillis - lastUpdateMillis
-	;
+	return currentMillis - lastUpdateMillis; // unsigned arithmetic handles the overflow
 }
 
 uint32_t NTPClient::unixSeconds(const uint32_t currentMillis) const {
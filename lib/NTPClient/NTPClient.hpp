@@ -4,8 +4,14 @@
 #include <WiFiUdp.h>
 
 /**
- * Simple SNTP client.
+ * Simple asynchronous SNTP client, querying multiple servers at once.
  * See https://datatracker.ietf.org/doc/rfc5905/ for the protocol details.
+ *
+ * Synchronization is started by `startSync` and progressed by `poll` calls,
+ * which never block: server names are resolved asynchronously (and cached),
+ * requests are sent to all servers, and replies are collected until all
+ * servers answer or the timeout expires. Sample with the lowest round-trip
+ * delay is selected as the result.
  */
 class NTPClient {
 public:
@@ -13,79 +19,171 @@ public:
 	static const char* const defaultPoolServerName;
 	static const uint32_t offsetFrom1900 = 2208988800;
 
+	static constexpr uint8_t maxServers = 4;
+
+	/**
+	 * How long resolved server address is used before resolving it again.
+	 */
+	static constexpr uint32_t addressLifetimeMillis = 24 * 60 * 60 * 1000;
+
+	/**
+	 * Time sample got from the server, as for the moment the reply was received.
+	 */
+	struct Sample {
+		/**
+		 * Local `millis()` timestamp of receiving the reply.
+		 */
+		uint32_t receivedMillis;
+		/**
+		 * Seconds since Unix epoch (Jan 1 1970), at the moment of receiving the reply
+		 * (server transmit time adjusted by half of round-trip delay).
+		 */
+		uint32_t seconds;
+		/**
+		 * Fraction of the second, in 1/2^32 units.
+		 */
+		uint32_t fraction;
+		/**
+		 * Round-trip delay, excluding server processing time, in microseconds.
+		 */
+		uint32_t delayMicros;
+		/**
+		 * Index of the server the sample is from.
+		 */
+		uint8_t server;
+		uint8_t stratum;
+
+		/**
+		 * Returns microseconds part of the time.
+		 */
+		inline uint32_t micros() const {
+			return static_cast<uint32_t>((static_cast<uint64_t>(fraction) * 1'000'000) >> 32);
+		}
+	};
+
+	enum class Status : uint8_t {
+		Idle,       // no synchronization in progress
+		InProgress, // waiting for addresses or replies
+		Success,    // just finished with at least one valid sample
+		Failed,     // just finished without valid samples
+	};
+
 protected:
+	struct Server {
+		enum class State : uint8_t {
+			Unresolved,
+			Resolving,
+			Resolved,
+			Failed, // resolving or sending failed, skipped for current synchronization
+		};
+
+		const char* name; // null if specified by address only
+		IPAddress address;
+		uint32_t resolvedMillis;
+		State state;
+
+		// Current synchronization
+		bool sent;
+		bool answered;
+		uint32_t sentMicros;
+		uint32_t cookie; // sent as transmit timestamp, expected to be echoed back as origin timestamp
+	};
+
 	UDP& udp;
+	Server servers[maxServers];
+	uint8_t serversCount = 0;
 
-	union {
-		ip4_addr_t poolServerIP;
-		const char* poolServerName;
-		static_assert(sizeof(poolServerName) == sizeof(poolServerIP));
-	};
+	Status status = Status::Idle;
+	uint32_t syncStartMillis;
+	uint32_t timeoutMillis;
+	uint32_t cookieCounter = 0;
+	bool hasCandidate;
+	Sample candidate; // best sample of current synchronization
+	Sample sample; // result of last successful synchronization
 
-	bool poolServerSpecifiedByName;
+	static constexpr size_t ntpPacketSize = 48;
 
-public:
-	ip4_addr_t getPoolServerIP() const;
-	const char* getPoolServerName() const;
-	void setPoolServerIP(const ip4_addr_t ip);
-	void setPoolServerName(const char* name);
+	static void dnsFoundCallback(const char* name, const ip_addr_t* address, void* arg);
 
 	/**
-	 * Returns number of minutes offset used, relative to UTC time.
-	 */
-	int16_t getTimeOffset() const;
-	/**
-	 * Set returns number of minutes offset used, relative to UTC time.
+	 * Starts resolving server address, if not resolved already (or it expired).
 	 */
-	void setTimeOffset(int16_t minutes);
+	void resolve(Server& server, uint32_t currentMillis);
 
 	/**
-	 * Last update `millis()` timestamp.
+	 * Sends NTP packet to the server.
+	 *
+	 * Returns false is something went wrong.
 	 */
-	uint32_t lastUpdateMillis;
+	bool sendNTPPacket(Server& server);
 
 	/**
-	 * Seconds part of latest response got from the NTP server, with configured time offset applied.
+	 * Reads all available replies, updating the candidate sample.
 	 */
-	uint32_t lastResponseSeconds;
+	void receive();
+
 	/**
-	 * Milliseconds converted from fraction part of latest response got from the NTP server.
+	 * Finishes synchronization, selecting the result.
 	 */
-	uint16_t lastResponseMillis;
+	Status finish();
 
+public:
 	NTPClient(UDP& udp)
-		: udp(udp), poolServerName(defaultPoolServerName), poolServerSpecifiedByName(true)
+		: udp(udp)
 	{}
 
-	NTPClient(UDP& udp, const char* poolServerName)
-		: udp(udp), poolServerName(poolServerName), poolServerSpecifiedByName(true)
-	{}
+	/**
+	 * Adds server to be queried, by its name. Name needs to be kept valid.
+	 *
+	 * Returns false if there are too many servers already.
+	 */
+	bool addServer(const char* name);
+	/**
+	 * Adds server to be queried, by its address.
+	 *
+	 * Returns false if there are too many servers already.
+	 */
+	bool addServer(IPAddress address);
 
-	NTPClient(UDP& udp, ip4_addr_t poolServerIP)
-		: udp(udp), poolServerIP(poolServerIP), poolServerSpecifiedByName(false)
-	{}
+	/**
+	 * Starts the synchronization, if not in progress already.
+	 */
+	void startSync(uint32_t timeoutMillis = 2000);
 
-protected:
-	static constexpr size_t ntpPacketSize = 48;
+	/**
+	 * Progresses the synchronization without blocking. Final status
+	 * (success or failure) is reported only once, `Idle` after that.
+	 */
+	Status poll();
+
+	inline bool isSyncInProgress() const {
+		return status == Status::InProgress;
+	}
 
 	/**
-	 * Sends NTP packet to the server.
-	 * 
-	 * Returns false is something went wrong.
+	 * Sample selected by last successful synchronization.
 	 */
-	bool sendNTPPacket();
+	inline const Sample& lastSample() const {
+		return sample;
+	}
 
-public:
 	/**
-	 * Updates the time hold by NTP client. 
-	 * 
-	 * Returns false is something went wrong, like timeout.
+	 * Last update `millis()` timestamp.
 	 */
-	bool update(unsigned long timeout = 500);
+	uint32_t lastUpdateMillis;
+
+	/**
+	 * Seconds part of latest response got from the NTP server.
+	 */
+	uint32_t lastResponseSeconds;
+	/**
+	 * Milliseconds converted from fraction part of latest response got from the NTP server.
+	 */
+	uint16_t lastResponseMillis;
 
 	/**
 	 * Return total milliseconds since last update for given `millis()` timestamp.
-	 * 
+	 *
 	 * Overflow can happen if not updated at least once per like 40 days.
 	 */
 	uint32_t millisSinceUpdate(const uint32_t currentMillis) const;
@@ -105,7 +203,7 @@ public:
 	 */
 	uint64_t unixMillis(const uint32_t currentMillis) const;
 	/**
-	 * Return time as number of milliseconds since Unix epoch (Jan 1 1970).
+	 * Return current time as number of milliseconds since Unix epoch (Jan 1 1970).
 	 */
 	uint64_t unixMillis() const;
 };
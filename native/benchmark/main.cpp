@@ -0,0 +1,988 @@
+// Host-native micro-benchmarks of the rendering code, covering every sprite
+// type and asset path of `pages::updatePagesStuff`, as well as the building
+// blocks it uses (bitmaps drawing, compositor, text formatting, converter).
+// Assets and pages are generated into temporary data directory at start.
+//
+// Usage: benchmark [options...]
+//   --filter <text>             run only benchmarks with names containing the text
+//   --min-time <ms>             minimal measured time per benchmark (default 200)
+//   --refresh-overhead <us>     display refresh overhead for the CPU share model,
+//                               as measured on device (average call duration
+//                               minus lit time, see `/metrics`)
+//
+// Results are printed as JSON lines, one per benchmark:
+//   {"name":"...","iterations":N,"ns_per_op":X,"allocs_per_op":X,"alloc_bytes_per_op":X}
+// with `processed_bytes_per_op` added for throughput benchmarks. Host timings
+// are only comparable between runs on the same machine, but allocations
+// per operation are expected to match the device.
+//
+// Display refresh model predictions are printed as JSON lines too:
+//   {"name":"refresh/model/...","interval_ms":N,"show_time_us":N,"brightness":N,"call_us":X,"cpu_share":X}
+
+#include "common.hpp"
+#include "bitmap.hpp"
+#include "AssetCache.hpp"
+#include "ColorGradient.hpp"
+#include "Compositor.hpp"
+#include "DisplayRefresh.hpp"
+#include "TimeFormat.hpp"
+#include "TimeService.hpp"
+#include "pages/Renderer.hpp"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+#include <unistd.h> // getpid
+
+PxMATRIX display(MATRIX_WIDTH, MATRIX_HEIGHT, 0, 0, 0, 0);
+Compositor compositor(MATRIX_WIDTH, MATRIX_HEIGHT);
+float temperature = 21.5f;
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocations counting
+
+namespace {
+	size_t allocationsCount = 0;
+	size_t allocationsBytes = 0;
+}
+
+void* operator new(size_t size) {
+	allocationsCount += 1;
+	allocationsBytes += size;
+	if (void* pointer = std::malloc(size ? size : 1)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	allocationsCount += 1;
+	allocationsBytes += size;
+	return std::malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+	return operator new(size, tag);
+}
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+// Harness
+
+using Clock = std::chrono::steady_clock;
+
+const char* filter = nullptr;
+double minTimeNs = 200e6;
+float refreshOverhead = DisplayRefresh::Model().overhead;
+
+struct Measurement {
+	uint64_t iterations = 0;
+	double ns = 0;
+	size_t allocationsCount = 0;
+	size_t allocationsBytes = 0;
+};
+
+void report(const char* name, const Measurement& m, size_t processedBytes = 0) {
+	std::printf("{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,\"allocs_per_op\":%.3f,\"alloc_bytes_per_op\":%.1f",
+		name, static_cast<unsigned long long>(m.iterations), m.ns / m.iterations,
+		static_cast<double>(m.allocationsCount) / m.iterations,
+		static_cast<double>(m.allocationsBytes) / m.iterations);
+	if (processedBytes) {
+		std::printf(",\"processed_bytes_per_op\":%zu", processedBytes);
+	}
+	std::printf("}\n");
+	std::fflush(stdout);
+}
+
+inline bool selected(const char* name) {
+	return !filter || std::strstr(name, filter);
+}
+
+/// \brief Runs the body in growing batches, until minimal time is reached.
+/// Suitable for operations without state to be reset between iterations.
+template <typename Body>
+void benchmark(const char* name, Body body, size_t processedBytes = 0) {
+	if (!selected(name)) {
+		return;
+	}
+	body(); // warm up (caches, lazy allocations)
+
+	Measurement m;
+	uint64_t batch = 1;
+	while (m.ns < minTimeNs) {
+		const size_t count = allocationsCount;
+		const size_t bytes = allocationsBytes;
+		const auto start = Clock::now();
+		for (uint64_t i = 0; i < batch; i++) {
+			body();
+		}
+		const auto end = Clock::now();
+		m.allocationsCount += allocationsCount - count;
+		m.allocationsBytes += allocationsBytes - bytes;
+		m.ns += std::chrono::duration<double, std::nano>(end - start).count();
+		m.iterations += batch;
+		batch *= 2;
+	}
+	report(name, m, processedBytes);
+}
+
+/// \brief Runs the body timing each iteration separately, so the state can
+/// be prepared by the setup (not measured) before each of them.
+template <typename Setup, typename Body>
+void benchmark(const char* name, Setup setup, Body body) {
+	if (!selected(name)) {
+		return;
+	}
+	setup();
+	body(); // warm up (caches, lazy allocations)
+
+	Measurement m;
+	while (m.ns < minTimeNs) {
+		setup();
+		const size_t count = allocationsCount;
+		const size_t bytes = allocationsBytes;
+		const auto start = Clock::now();
+		body();
+		const auto end = Clock::now();
+		m.allocationsCount += allocationsCount - count;
+		m.allocationsBytes += allocationsBytes - bytes;
+		m.ns += std::chrono::duration<double, std::nano>(end - start).count();
+		m.iterations += 1;
+	}
+	report(name, m);
+}
+
+/// Prevents the compiler from optimizing out the value.
+template <typename T>
+inline void doNotOptimize(const T& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Output stream discarding everything (unless capturing), for converter benchmarks.
+class NullStream : public Stream {
+public:
+	size_t written = 0;
+	std::string* captured = nullptr;
+	size_t write(uint8_t c) override { return write(&c, 1); }
+	size_t write(const uint8_t* buffer, size_t size) override {
+		if (captured) [[unlikely]] {
+			captured->append(reinterpret_cast<const char*>(buffer), size);
+		}
+		written += size;
+		return size;
+	}
+	using Print::write;
+	int available() override { return 0; }
+	int read() override { return -1; }
+	int peek() override { return -1; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Data generation
+
+constexpr uint16_t transparentColor = colors::to565(colors::RGB {255, 0, 255});
+constexpr int16_t iconSize = 16;
+
+/// Generates test pattern, with transparent corners (if any) for icons.
+std::vector<uint16_t> pattern(int16_t width, int16_t height, bool transparentCorners) {
+	std::vector<uint16_t> pixels(static_cast<size_t>(width) * height);
+	for (int16_t y = 0; y < height; y++) {
+		for (int16_t x = 0; x < width; x++) {
+			uint16_t color = colors::to565(colors::RGB {
+				static_cast<uint8_t>(x * 255 / width),
+				static_cast<uint8_t>(y * 255 / height),
+				static_cast<uint8_t>((x ^ y) * 8)
+			});
+			if (transparentCorners) {
+				const int dx = 2 * x - width + 1;
+				const int dy = 2 * y - height + 1;
+				if (dx * dx + dy * dy > width * height) {
+					color = transparentColor;
+				}
+			}
+			pixels[y * width + x] = color;
+		}
+	}
+	return pixels;
+}
+
+/// Generates alpha for icons: opaque circle, with antialiased edge.
+std::vector<uint8_t> circleAlpha(int16_t width, int16_t height) {
+	std::vector<uint8_t> alpha(static_cast<size_t>(width) * height);
+	const float radius = std::min(width, height) / 2.0f - 1;
+	for (int16_t y = 0; y < height; y++) {
+		for (int16_t x = 0; x < width; x++) {
+			const float distance = std::hypot(x + 0.5f - width / 2.0f, y + 0.5f - height / 2.0f);
+			const float coverage = std::clamp(radius - distance + 0.5f, 0.0f, 1.0f);
+			alpha[y * width + x] = static_cast<uint8_t>(coverage * 255 + 0.5f);
+		}
+	}
+	return alpha;
+}
+
+BMP::Headers makeHeaders(int16_t width, int16_t height, uint16_t bitsPerPixel, bool withAlpha = false) {
+	const size_t rowLengthInBytes = width * bitsPerPixel / 8;
+	const size_t rowPadding = (rowLengthInBytes % 4 > 0) ? (4 - rowLengthInBytes % 4) : 0;
+	BMP::Headers headers;
+	std::memset(static_cast<void*>(&headers), 0, sizeof(headers)); // DIB header constructor leaves fields uninitialized
+	headers.fileHeader.signature = BMP::expectedSignature;
+	headers.dibHeader.headerSize = 40;
+	headers.dibHeader.width = width;
+	headers.dibHeader.height = height;
+	headers.dibHeader.planes = 1;
+	headers.dibHeader.bitPerPixel = bitsPerPixel;
+	headers.dibHeader.imageSize = (rowLengthInBytes + rowPadding) * height;
+	if (bitsPerPixel == 16 || withAlpha) {
+		headers.fileHeader.offsetToPixelArray = sizeof(headers);
+		headers.dibHeader.compression = 3; // BI_BITFIELDS
+		headers.dibHeader.redMask = 0xF800;
+		headers.dibHeader.greenMask = 0x07E0;
+		headers.dibHeader.blueMask = 0x001F;
+	}
+	else {
+		headers.fileHeader.offsetToPixelArray = sizeof(BMP::BITMAPFILEHEADER) + sizeof(BMP::BITMAPINFOHEADER);
+	}
+	headers.fileHeader.size = headers.fileHeader.offsetToPixelArray + headers.dibHeader.imageSize;
+	return headers;
+}
+
+/// Encodes pixels as 16 bits BMP file, as stored by the device.
+std::string encodeBitmap(const std::vector<uint16_t>& pixels, int16_t width, int16_t height) {
+	const BMP::Headers headers = makeHeaders(width, height, 16);
+	std::string data(reinterpret_cast<const char*>(&headers), sizeof(headers));
+	const size_t rowLengthInBytes = width * sizeof(uint16_t);
+	for (int16_t y = height - 1; y >= 0; y--) {
+		data.append(reinterpret_cast<const char*>(pixels.data() + y * width), rowLengthInBytes);
+		data.append((4 - rowLengthInBytes % 4) % 4, '\0');
+	}
+	return data;
+}
+
+/// Encodes pixels as 24 bits BMP file, as uploaded to the device for conversion.
+std::string encodeBitmap24(const std::vector<uint16_t>& pixels, int16_t width, int16_t height) {
+	const BMP::Headers headers = makeHeaders(width, height, 24);
+	std::string data(reinterpret_cast<const char*>(&headers), headers.fileHeader.offsetToPixelArray);
+	for (int16_t y = height - 1; y >= 0; y--) {
+		for (int16_t x = 0; x < width; x++) {
+			const uint16_t color = pixels[y * width + x];
+			data.push_back(static_cast<char>((color & 0x1F) << 3));
+			data.push_back(static_cast<char>(((color >> 5) & 0x3F) << 2));
+			data.push_back(static_cast<char>((color >> 11) << 3));
+		}
+		data.append((4 - width * 3 % 4) % 4, '\0');
+	}
+	return data;
+}
+
+void writeFile(const std::filesystem::path& path, const void* data, size_t size) {
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream output(path, std::ios::binary);
+	output.write(reinterpret_cast<const char*>(data), size);
+}
+
+pages::Page basePage() {
+	pages::Page page {};
+	page.signature = pages::Page::expectedSignature;
+	page.backgroundColors.setPrimary(colors::to565(colors::RGB {0, 0, 64}));
+	for (auto& sprite : page.sprites) {
+		sprite.common.type = pages::Sprite::Type::None;
+	}
+	return page;
+}
+
+pages::Sprite textSprite(uint8_t x, uint8_t y, const char* text) {
+	pages::Sprite sprite {};
+	sprite.text = {};
+	sprite.text.setText(text);
+	sprite.text.x = x;
+	sprite.text.y = y;
+	return sprite;
+}
+
+pages::Sprite timeSprite(uint8_t x, uint8_t y, const char* format) {
+	pages::Sprite sprite {};
+	sprite.time = {};
+	sprite.time.setFormat(format);
+	sprite.time.x = x;
+	sprite.time.y = y;
+	return sprite;
+}
+
+pages::Sprite temperatureSprite(uint8_t x, uint8_t y) {
+	pages::Sprite sprite {};
+	sprite.temperature = pages::Sprite::Temperature();
+	sprite.temperature.x = x;
+	sprite.temperature.y = y;
+	return sprite;
+}
+
+pages::Sprite imageSprite(uint8_t x, uint8_t y, const char* path, uint16_t transparent = 0) {
+	pages::Sprite sprite {};
+	sprite.image = {};
+	sprite.image.setPath(path);
+	sprite.image.transparentColor = transparent;
+	sprite.image.x = x;
+	sprite.image.y = y;
+	return sprite;
+}
+
+pages::Sprite customCharSprite(uint8_t x, uint8_t y) {
+	pages::Sprite sprite {};
+	sprite.customChar = {};
+	for (uint8_t i = 0; i < sizeof(sprite.customChar.data); i++) {
+		sprite.customChar.data[i] = static_cast<uint8_t>(0xA5 ^ (i * 37));
+	}
+	sprite.customChar.width = 12;
+	sprite.customChar.x = x;
+	sprite.customChar.y = y;
+	return sprite;
+}
+
+pages::AnalogClock analogClock(bool antialiased) {
+	pages::AnalogClock clock {};
+	clock.centerX = 16;
+	clock.centerY = 16;
+	clock.centerColor = 0xFFFF;
+	clock.hourArrowColor = 0x07E0;
+	clock.minuteArrowColor = 0x001F;
+	clock.secondArrowColor = 0xF800;
+	clock.hourArrowLength = 8;
+	clock.minuteArrowLength = 12;
+	clock.secondArrowLength = 14;
+	clock.antialiased = antialiased;
+	return clock;
+}
+
+/// Page scenarios, IDs are used as page numbers.
+enum PageId : uint8_t {
+	BackgroundColorPage,
+	BackgroundBitmapPage,
+	TextPage,
+	TimePage,
+	TemperaturePage,
+	ImagePage,
+	ImageTransparentPage,
+	ImageAlphaPage,
+	ImageAlphaIconsPage,
+	CustomCharPage,
+	ClockPage,
+	ClockAntialiasedPage,
+	AllPage,
+};
+
+/// Encodes pixels with alpha as 24 bits RGB565A8 BMP file, as stored by the device.
+std::string encodeBitmapAlpha(const std::vector<uint16_t>& pixels, const std::vector<uint8_t>& alpha, int16_t width, int16_t height) {
+	const BMP::Headers headers = makeHeaders(width, height, 24, true);
+	std::string data(reinterpret_cast<const char*>(&headers), sizeof(headers));
+	for (int16_t y = height - 1; y >= 0; y--) {
+		for (int16_t x = 0; x < width; x++) {
+			const uint16_t color = pixels[y * width + x];
+			data.push_back(static_cast<char>(color));
+			data.push_back(static_cast<char>(color >> 8));
+			data.push_back(static_cast<char>(alpha[y * width + x]));
+		}
+		data.append((4 - width * 3 % 4) % 4, '\0');
+	}
+	return data;
+}
+
+/// Encodes pixels with alpha as 32 bits BMP file, as uploaded to the device for conversion.
+std::string encodeBitmap32(const std::vector<uint16_t>& pixels, const std::vector<uint8_t>& alpha, int16_t width, int16_t height) {
+	const BMP::Headers headers = makeHeaders(width, height, 32);
+	std::string data(reinterpret_cast<const char*>(&headers), headers.fileHeader.offsetToPixelArray);
+	for (int16_t y = height - 1; y >= 0; y--) {
+		for (int16_t x = 0; x < width; x++) {
+			const uint16_t color = pixels[y * width + x];
+			data.push_back(static_cast<char>((color & 0x1F) << 3));
+			data.push_back(static_cast<char>(((color >> 5) & 0x3F) << 2));
+			data.push_back(static_cast<char>((color >> 11) << 3));
+			data.push_back(static_cast<char>(alpha[y * width + x]));
+		}
+	}
+	return data;
+}
+
+void generateData(const std::filesystem::path& root) {
+	const auto background = pattern(MATRIX_WIDTH, MATRIX_HEIGHT, false);
+	const auto backgroundData = encodeBitmap(background, MATRIX_WIDTH, MATRIX_HEIGHT);
+	writeFile(root / "assets/bg.bmp", backgroundData.data(), backgroundData.size());
+
+	// Short names, as sprite paths are limited to 15 characters
+	const auto icon = pattern(iconSize, iconSize, true);
+	const auto iconData = encodeBitmap(icon, iconSize, iconSize);
+	writeFile(root / "assets/ico.bmp", iconData.data(), iconData.size());
+
+	const auto iconAlphaData = encodeBitmapAlpha(pattern(iconSize, iconSize, false), circleAlpha(iconSize, iconSize), iconSize, iconSize);
+	writeFile(root / "assets/ica.bmp", iconAlphaData.data(), iconAlphaData.size());
+
+	std::vector<std::pair<PageId, pages::Page>> pagesToWrite;
+	auto add = [&](PageId id, auto modify) {
+		pages::Page page = basePage();
+		modify(page);
+		pagesToWrite.emplace_back(id, page);
+	};
+	add(BackgroundColorPage, [](pages::Page&) {});
+	add(BackgroundBitmapPage, [](pages::Page& page) {
+		std::strcpy(page.backgroundPath, "/assets/bg.bmp");
+	});
+	add(TextPage, [](pages::Page& page) {
+		page.sprites[0] = textSprite(1, 1, "Hello world");
+	});
+	add(TimePage, [](pages::Page& page) {
+		page.sprites[0] = timeSprite(1, 1, "%H:%M:%S");
+	});
+	add(TemperaturePage, [](pages::Page& page) {
+		page.sprites[0] = temperatureSprite(1, 1);
+	});
+	add(ImagePage, [](pages::Page& page) {
+		page.sprites[0] = imageSprite(8, 8, "/assets/ico.bmp");
+	});
+	add(ImageTransparentPage, [](pages::Page& page) {
+		page.sprites[0] = imageSprite(8, 8, "/assets/ico.bmp", transparentColor);
+	});
+	add(ImageAlphaPage, [](pages::Page& page) {
+		std::strcpy(page.backgroundPath, "/assets/bg.bmp");
+		page.sprites[0] = imageSprite(8, 8, "/assets/ica.bmp");
+	});
+	add(ImageAlphaIconsPage, [](pages::Page& page) {
+		std::strcpy(page.backgroundPath, "/assets/bg.bmp");
+		for (uint8_t i = 0; i < 4; i++) {
+			page.sprites[i] = imageSprite(i * iconSize, i % 2 * iconSize, "/assets/ica.bmp");
+		}
+	});
+	add(CustomCharPage, [](pages::Page& page) {
+		page.sprites[0] = customCharSprite(1, 1);
+	});
+	add(ClockPage, [](pages::Page& page) {
+		std::strcpy(page.backgroundPath, "/assets/bg.bmp");
+		page.analog = analogClock(false);
+	});
+	add(ClockAntialiasedPage, [](pages::Page& page) {
+		std::strcpy(page.backgroundPath, "/assets/bg.bmp");
+		page.analog = analogClock(true);
+	});
+	add(AllPage, [](pages::Page& page) {
+		std::strcpy(page.backgroundPath, "/assets/bg.bmp");
+		page.sprites[0] = textSprite(32, 0, "T:");
+		page.sprites[1] = temperatureSprite(44, 0);
+		page.sprites[2] = timeSprite(16, 24, "%H:%M:%S");
+		page.sprites[3] = imageSprite(0, 0, "/assets/ico.bmp", transparentColor);
+		page.sprites[4] = customCharSprite(20, 10);
+	});
+	for (const auto& [id, page] : pagesToWrite) {
+		writeFile(root / "pages" / std::to_string(id) / "config", &page, sizeof(page));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+/// Single display update, as run by the main loop tasks.
+void renderFrame() {
+	TimeService::update();
+	pages::updatePagesStuff();
+}
+
+void benchmarkPages() {
+	struct Scenario {
+		const char* name;
+		PageId page;
+	};
+	static constexpr Scenario scenarios[] = {
+		{ "background-color",  BackgroundColorPage },
+		{ "background-bitmap", BackgroundBitmapPage },
+		{ "text",              TextPage },
+		{ "time",              TimePage },
+		{ "temperature",       TemperaturePage },
+		{ "image",             ImagePage },
+		{ "image-transparent", ImageTransparentPage },
+		{ "image-alpha",       ImageAlphaPage },
+		{ "image-alpha-icons", ImageAlphaIconsPage },
+		{ "custom-char",       CustomCharPage },
+		{ "clock",             ClockPage },
+		{ "clock-antialiased", ClockAntialiasedPage },
+		{ "all",               AllPage },
+	};
+	char name[64];
+	for (const auto& scenario : scenarios) {
+		// Full update, as after page change (untimed), with assets cached
+		std::snprintf(name, sizeof(name), "page/%s/full", scenario.name);
+		benchmark(name,
+			[&] { pages::changeActivePage(scenario.page); },
+			renderFrame
+		);
+
+		// Update with nothing changed
+		std::snprintf(name, sizeof(name), "page/%s/idle", scenario.name);
+		if (selected(name)) {
+			pages::changeActivePage(scenario.page);
+			renderFrame();
+			benchmark(name, renderFrame);
+		}
+	}
+
+	// Update every second, as for clocks
+	benchmark("page/time/tick",
+		[] {
+			pages::changeActivePage(TimePage);
+			renderFrame();
+			native::advanceMillis(1000);
+		},
+		renderFrame
+	);
+	benchmark("page/clock/tick",
+		[] {
+			pages::changeActivePage(ClockPage);
+			renderFrame();
+			native::advanceMillis(1000);
+		},
+		renderFrame
+	);
+	benchmark("page/clock-antialiased/tick",
+		[] {
+			pages::changeActivePage(ClockAntialiasedPage);
+			renderFrame();
+			native::advanceMillis(1000);
+		},
+		renderFrame
+	);
+	benchmark("page/all/tick",
+		[] {
+			pages::changeActivePage(AllPage);
+			renderFrame();
+			native::advanceMillis(1000);
+		},
+		renderFrame
+	);
+}
+
+void benchmarkBitmaps() {
+	const Surface target = compositor.frameSurface();
+	const Rect clip = target.bounds();
+
+	const auto background = pattern(MATRIX_WIDTH, MATRIX_HEIGHT, false);
+	benchmark("bmp/draw-cached/background", [&] {
+		BMP::draw(target, background.data(), MATRIX_WIDTH, MATRIX_HEIGHT, 0, 0, 0, clip);
+	});
+
+	const auto icon = pattern(iconSize, iconSize, true);
+	benchmark("bmp/draw-cached/opaque", [&] {
+		BMP::draw(target, icon.data(), iconSize, iconSize, 8, 8, 0, clip);
+	});
+	benchmark("bmp/draw-cached/transparent", [&] {
+		BMP::draw(target, icon.data(), iconSize, iconSize, 8, 8, transparentColor, clip);
+	});
+	size_t spansSizeInBytes;
+	uint16_t* spans = BMP::computeOpaqueSpans(icon.data(), iconSize, iconSize, transparentColor, spansSizeInBytes);
+	benchmark("bmp/draw-cached/spans", [&] {
+		BMP::draw(target, icon.data(), spans, iconSize, iconSize, 8, 8, clip);
+	});
+	const auto iconAlpha = circleAlpha(iconSize, iconSize);
+	benchmark("bmp/draw-cached/alpha", [&] {
+		BMP::draw(target, icon.data(), iconAlpha.data(), iconSize, iconSize, 8, 8, clip);
+	});
+	benchmark("bmp/compute-spans", [&] {
+		size_t size;
+		delete[] BMP::computeOpaqueSpans(icon.data(), iconSize, iconSize, transparentColor, size);
+	});
+	delete[] spans;
+
+	struct FileCase {
+		const char* name;
+		const char* path;
+		int16_t x, y;
+		uint16_t transparent;
+	};
+	static constexpr FileCase fileCases[] = {
+		{ "bmp/draw-file/background",  "/assets/bg.bmp",   0, 0, 0 },
+		{ "bmp/draw-file/opaque",      "/assets/ico.bmp", 8, 8, 0 },
+		{ "bmp/draw-file/transparent", "/assets/ico.bmp", 8, 8, transparentColor },
+		{ "bmp/draw-file/alpha",       "/assets/ica.bmp", 8, 8, 0 },
+	};
+	// Sanity check, as blending from file reads rows in chunks, split into colors and alpha
+	{
+		File file = LittleFS.open("/assets/ica.bmp", "r");
+		BMP::Headers headers;
+		std::vector<uint16_t> cached(MATRIX_WIDTH * MATRIX_HEIGHT);
+		std::vector<uint16_t> streamed(MATRIX_WIDTH * MATRIX_HEIGHT);
+		BMP::draw(target, background.data(), MATRIX_WIDTH, MATRIX_HEIGHT, 0, 0, 0, clip);
+		BMP::draw(target, icon.data(), iconAlpha.data(), iconSize, iconSize, 7, 9, clip);
+		std::memcpy(cached.data(), target.row(0), cached.size() * sizeof(uint16_t));
+		BMP::draw(target, background.data(), MATRIX_WIDTH, MATRIX_HEIGHT, 0, 0, 0, clip);
+		if (!file || !BMP::readHeaders(file, headers) || !BMP::draw(target, file, headers, 7, 9, 0, clip)) {
+			std::fprintf(stderr, "Failed to draw '/assets/icon-alpha.bmp'\n");
+		}
+		std::memcpy(streamed.data(), target.row(0), streamed.size() * sizeof(uint16_t));
+		if (cached != streamed || cached[9 * MATRIX_WIDTH + 7] != background[9 * MATRIX_WIDTH + 7]) {
+			std::fprintf(stderr, "Blending from file differs from blending cached pixels\n");
+		}
+	}
+	for (const auto& fileCase : fileCases) {
+		File file = LittleFS.open(fileCase.path, "r");
+		BMP::Headers headers;
+		if (!file || !BMP::readHeaders(file, headers)) {
+			std::fprintf(stderr, "Failed to read '%s'\n", fileCase.path);
+			continue;
+		}
+		benchmark(fileCase.name, [&] {
+			file.seek(sizeof(headers));
+			BMP::draw(target, file, headers, fileCase.x, fileCase.y, fileCase.transparent, clip);
+		});
+	}
+
+	benchmark("asset-cache/find", [] {
+		doNotOptimize(assetCache.find("/assets/ico.bmp", 0));
+	});
+}
+
+void benchmarkCompositor() {
+	const Rect full = compositor.bounds();
+	const Rect small = Rect::fromSize(8, 8, iconSize, iconSize);
+	benchmark("compositor/fill-background", [] {
+		compositor.fillBackground(colors::to565(colors::RGB {0, 0, 64}));
+	});
+	benchmark("compositor/restore/full",  [&] { compositor.restore(full); });
+	benchmark("compositor/restore/small", [&] { compositor.restore(small); });
+	benchmark("compositor/present/full",  [&] { compositor.present(display, full); });
+	benchmark("compositor/present/small", [&] { compositor.present(display, small); });
+}
+
+void benchmarkText() {
+	benchmark("text/strftime/local", [] {
+		char buffer[24];
+		std::time_t time = std::time({});
+		std::strftime(buffer, sizeof(buffer), "%H:%M:%S", std::localtime(&time));
+		doNotOptimize(buffer);
+	});
+	benchmark("text/strftime/utc", [] {
+		char buffer[24];
+		std::time_t time = std::time({});
+		std::strftime(buffer, sizeof(buffer), "%H:%M:%S", std::gmtime(&time));
+		doNotOptimize(buffer);
+	});
+	benchmark("text/timeService/tick",
+		[] { native::advanceMillis(1000); },
+		[] { TimeService::update(); }
+	);
+	benchmark("text/timeService/idle", [] {
+		doNotOptimize(TimeService::update());
+	});
+
+	TimeFormat format;
+	format.compile("%H:%M:%S");
+	benchmark("text/timeFormat/local", [&] {
+		char buffer[24];
+		std::time_t time = std::time({});
+		format.format(buffer, sizeof(buffer), time, *std::localtime(&time));
+		doNotOptimize(buffer);
+	});
+	benchmark("text/timeFormat/due", [&] {
+		std::time_t time = std::time({});
+		doNotOptimize(format.isDue(time));
+	});
+
+	const pages::Sprite sprite = temperatureSprite(0, 0);
+	float value = 0;
+	benchmark("text/temperature/color", [&] {
+		value = value > 40 ? -10 : value + 0.1f;
+		doNotOptimize(sprite.temperature.interpolateColor(value));
+	});
+	uint16_t table[256];
+	ColorGradient gradient;
+	gradient.bake(sprite.temperature.referenceValue[0], sprite.temperature.referenceValue[2], table, 256, 
+		[&](float value) { return sprite.temperature.interpolateColor(value); });
+	benchmark("text/temperature/color-lut", [&] {
+		value = value > 40 ? -10 : value + 0.1f;
+		doNotOptimize(gradient.at(value));
+	});
+	benchmark("text/temperature/format", [&] {
+		char buffer[24];
+		value = value > 40 ? -10 : value + 0.1f;
+		snprintf(buffer, sizeof(buffer), "%.*f", sprite.temperature.precision, value);
+		doNotOptimize(buffer);
+	});
+
+	auto& canvas = compositor.canvas();
+	benchmark("text/print", [&] {
+		canvas.setFont(nullptr);
+		canvas.setTextColor(0xFFFF);
+		canvas.setCursor(1, 1);
+		canvas.print("12:34:56");
+	});
+}
+
+void benchmarkColors() {
+	using namespace colors;
+
+	// Conversions and interpolation: float (reference) vs fixed-point
+	uint16_t color = 0;
+	benchmark("colors/hsl/float", [&] {
+		color += 0x0841;
+		doNotOptimize(to565(toRGB(toHSL(color))));
+	});
+	benchmark("colors/hsl/fixed", [&] {
+		color += 0x0841;
+		doNotOptimize(to565(toRGB(toFixedHSL(color))));
+	});
+	benchmark("colors/hsv/fixed", [&] {
+		color += 0x0841;
+		doNotOptimize(to565(toRGB(toFixedHSV(color))));
+	});
+	float ratio = 0;
+	benchmark("colors/interpolate/float", [&] {
+		ratio = ratio >= 1 ? 0 : ratio + 0.01f;
+		doNotOptimize(to565(toRGB(interpolateHSL(toHSL(uint16_t(0x001F)), toHSL(uint16_t(0xF800)), ratio))));
+	});
+	benchmark("colors/interpolate/fixed", [&] {
+		ratio = ratio >= 1 ? 0 : ratio + 0.01f;
+		doNotOptimize(to565(toRGB(interpolateHSL(toFixedHSL(uint16_t(0x001F)), toFixedHSL(uint16_t(0xF800)),
+			static_cast<uint16_t>(ratio * 256)))));
+	});
+
+	// Kernels over row of pixels: float per pixel (reference) vs SWAR pairs
+	const auto source = pattern(MATRIX_WIDTH, 2, false);
+	const uint16_t* a = source.data();
+	const uint16_t* b = source.data() + MATRIX_WIDTH;
+	uint16_t row[MATRIX_WIDTH];
+	constexpr size_t rowBytes = sizeof(row);
+	benchmark("colors/blend/float", [&] {
+		const float alpha = 0.25f;
+		for (int16_t x = 0; x < MATRIX_WIDTH; x++) {
+			const RGB first = toRGB(a[x]);
+			const RGB second = toRGB(b[x]);
+			row[x] = to565(RGB {
+				static_cast<uint8_t>(first.r * alpha + second.r * (1 - alpha)),
+				static_cast<uint8_t>(first.g * alpha + second.g * (1 - alpha)),
+				static_cast<uint8_t>(first.b * alpha + second.b * (1 - alpha)),
+			});
+		}
+		doNotOptimize(row);
+	}, rowBytes);
+	benchmark("colors/blend/swar", [&] {
+		for (int16_t x = 0; x < MATRIX_WIDTH; x += 2) {
+			const uint32_t pair = blend565x2(pack565x2(a[x], a[x + 1]), pack565x2(b[x], b[x + 1]), 64);
+			row[x] = pair;
+			row[x + 1] = pair >> 16;
+		}
+		doNotOptimize(row);
+	}, rowBytes);
+	benchmark("colors/brightness/float", [&] {
+		const float level = 0.75f;
+		for (int16_t x = 0; x < MATRIX_WIDTH; x++) {
+			const RGB pixel = toRGB(a[x]);
+			row[x] = to565(RGB {
+				static_cast<uint8_t>(pixel.r * level),
+				static_cast<uint8_t>(pixel.g * level),
+				static_cast<uint8_t>(pixel.b * level),
+			});
+		}
+		doNotOptimize(row);
+	}, rowBytes);
+	benchmark("colors/brightness/swar", [&] {
+		for (int16_t x = 0; x < MATRIX_WIDTH; x += 2) {
+			const uint32_t pair = scale565x2(pack565x2(a[x], a[x + 1]), 192);
+			row[x] = pair;
+			row[x + 1] = pair >> 16;
+		}
+		doNotOptimize(row);
+	}, rowBytes);
+	benchmark("colors/gamma/powf", [&] {
+		for (int16_t x = 0; x < MATRIX_WIDTH; x++) {
+			const RGB pixel = toRGB(a[x]);
+			row[x] = to565(RGB {
+				static_cast<uint8_t>(std::pow(pixel.r / 255.0f, 2.2f) * 255 + 0.5f),
+				static_cast<uint8_t>(std::pow(pixel.g / 255.0f, 2.2f) * 255 + 0.5f),
+				static_cast<uint8_t>(std::pow(pixel.b / 255.0f, 2.2f) * 255 + 0.5f),
+			});
+		}
+		doNotOptimize(row);
+	}, rowBytes);
+	benchmark("colors/gamma/table", [&] {
+		for (int16_t x = 0; x < MATRIX_WIDTH; x++) {
+			row[x] = gamma565(a[x]);
+		}
+		doNotOptimize(row);
+	}, rowBytes);
+}
+
+void benchmarkRefresh() {
+	// Predicted CPU share of the refresh for some configurations
+	DisplayRefresh::Model model;
+	model.overhead = refreshOverhead;
+	const DisplayRefresh::Config defaults;
+	for (uint8_t interval : { 2, 5, 8, 10 }) {
+		for (uint8_t brightness : { 63, 127, 255 }) {
+			char name[64];
+			std::snprintf(name, sizeof(name), "refresh/model/%ums/%u", interval, brightness);
+			if (!selected(name)) {
+				continue;
+			}
+			std::printf("{\"name\":\"%s\",\"interval_ms\":%u,\"show_time_us\":%u,\"brightness\":%u,\"call_us\":%.1f,\"cpu_share\":%.4f}\n",
+				name, interval, defaults.showTime, brightness,
+				model.callDuration(defaults.showTime, brightness),
+				model.cpuShare(defaults.showTime, brightness, interval));
+		}
+	}
+	std::fflush(stdout);
+
+	// Sanity check: simulated measurements of expensive refresh should
+	// calibrate the model and make the governor slow down to fit the budget
+	DisplayRefresh::Config config;
+	config.maxCpuShare = 2;
+	config.maxInterval = 20;
+	DisplayRefresh::configure(config);
+	constexpr float simulatedOverhead = 200;
+	uint32_t calls = 0;
+	uint64_t totalDuration = 0;
+	uint32_t now = 0;
+	for (int second = 0; second < 30; second++) {
+		const auto& state = DisplayRefresh::state();
+		const uint32_t duration = simulatedOverhead + static_cast<float>(state.showTime) * state.brightness / 255;
+		const uint32_t count = 1'000'000 / (state.interval * 1000);
+		calls += count;
+		totalDuration += uint64_t(count) * duration;
+		now += 1'000'000;
+		DisplayRefresh::update(calls, totalDuration, now, false);
+	}
+	const auto& state = DisplayRefresh::state();
+	if (std::abs(DisplayRefresh::model().overhead - simulatedOverhead) > 2 || !state.limited
+		|| state.predictedCpuShare > config.maxCpuShare / 100.0f
+	) {
+		std::fprintf(stderr, "Display refresh governor didn't settle (overhead %.1f us, interval %u ms, predicted share %.3f)\n",
+			DisplayRefresh::model().overhead, state.interval, state.predictedCpuShare);
+	}
+
+	// Sanity check: budget should be reachable even if configured slowest
+	// interval is not enough for the show time
+	config = DisplayRefresh::Config();
+	config.showTime = 1000;
+	config.interval = config.maxInterval = 1;
+	config.brightness = 255;
+	DisplayRefresh::configure(config);
+	DisplayRefresh::update(calls, totalDuration, now, false);
+	if (DisplayRefresh::state().predictedCpuShare > config.maxCpuShare / 100.0f) {
+		std::fprintf(stderr, "Display refresh governor can't fit long show time (interval %u ms, predicted share %.3f)\n",
+			DisplayRefresh::state().interval, DisplayRefresh::state().predictedCpuShare);
+	}
+
+	benchmark("refresh/governor/update", [&] {
+		calls += 200;
+		totalDuration += 200 * 250;
+		now += 1'000'000;
+		doNotOptimize(DisplayRefresh::update(calls, totalDuration, now, (now >> 20) & 1));
+	});
+	DisplayRefresh::configure(DisplayRefresh::Config());
+}
+
+/// Converts 24 bits BMP file in chunks, as received from uploads.
+/// \return true on error (like the converter)
+bool convert(const std::string& input, size_t chunkSize, NullStream& output) {
+	BMP::RGB565Converter converter;
+	converter.initialize();
+	bool error = false;
+	for (size_t offset = 0; offset < input.size(); offset += chunkSize) {
+		error |= converter.chunk(reinterpret_cast<const uint8_t*>(input.data()) + offset,
+			std::min(chunkSize, input.size() - offset), output);
+	}
+	return error | converter.finish();
+}
+
+void benchmarkConverter() {
+	constexpr size_t chunkSize = 512;
+
+	// Sanity check, as converting broken input would measure early returns 
+	// only; odd width and chunk sizes to cover leftovers of pixels and padding
+	for (int16_t width : { MATRIX_WIDTH, 30 }) {
+		const auto pixels = pattern(width, 16, false);
+		const auto input = encodeBitmap24(pixels, width, 16);
+		const auto expected = encodeBitmap(pixels, width, 16);
+		for (size_t size : { chunkSize, size_t(67), size_t(68) }) {
+			std::string converted;
+			NullStream output;
+			output.captured = &converted;
+			if (convert(input, size, output) || converted != expected) {
+				std::fprintf(stderr, "Converter output differs from expected (width %d, chunk size %zu)\n", width, size);
+			}
+		}
+	}
+
+	for (int16_t width : { iconSize, int16_t(15) }) {
+		const auto pixels = pattern(width, iconSize, false);
+		const auto alpha = circleAlpha(width, iconSize);
+		const auto input = encodeBitmap32(pixels, alpha, width, iconSize);
+		const auto expected = encodeBitmapAlpha(pixels, alpha, width, iconSize);
+		for (size_t size : { chunkSize, size_t(67), size_t(69) }) {
+			std::string converted;
+			NullStream output;
+			output.captured = &converted;
+			// Sizes in headers written by converter don't include rows padding, so only pixels are compared
+			if (convert(input, size, output) || converted.size() != expected.size() 
+				|| converted.compare(sizeof(BMP::Headers), std::string::npos, expected, sizeof(BMP::Headers)) != 0
+			) {
+				std::fprintf(stderr, "Converter output with alpha differs from expected (width %d, chunk size %zu)\n", width, size);
+			}
+		}
+	}
+
+	const auto pixels = pattern(MATRIX_WIDTH, MATRIX_HEIGHT, false);
+	const auto input = encodeBitmap24(pixels, MATRIX_WIDTH, MATRIX_HEIGHT);
+	benchmark("converter/chunk/rgb888", [&] {
+		NullStream output;
+		convert(input, chunkSize, output);
+		doNotOptimize(output.written);
+	}, input.size());
+	const auto inputAlpha = encodeBitmap32(pixels, circleAlpha(MATRIX_WIDTH, MATRIX_HEIGHT), MATRIX_WIDTH, MATRIX_HEIGHT);
+	benchmark("converter/chunk/rgba8888", [&] {
+		NullStream output;
+		convert(inputAlpha, chunkSize, output);
+		doNotOptimize(output.written);
+	}, inputAlpha.size());
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string option = argv[i];
+		const char* value = argv[i + 1];
+		/**/ if (option == "--filter")   filter = value;
+		else if (option == "--min-time") minTimeNs = std::atof(value) * 1e6;
+		else if (option == "--refresh-overhead") refreshOverhead = std::atof(value);
+		else {
+			std::fprintf(stderr, "Unknown option '%s'\n", option.c_str());
+			return 1;
+		}
+	}
+
+	std::error_code error;
+	const auto root = std::filesystem::temp_directory_path(error) / ("benchmark-" + std::to_string(getpid()));
+	generateData(root);
+	const std::string rootString = root.string();
+
+	setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+	tzset();
+	native::setTime(1700000000);
+	LittleFS.setRoot(rootString.c_str());
+	TimeService::update();
+	pages::setup();
+
+	benchmarkPages();
+	benchmarkBitmaps();
+	benchmarkCompositor();
+	benchmarkText();
+	benchmarkColors();
+	benchmarkConverter();
+	benchmarkRefresh();
+
+	std::filesystem::remove_all(root, error);
+	return 0;
+}
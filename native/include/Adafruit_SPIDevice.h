@@ -0,0 +1,2 @@
+#pragma once
+// Host-native stand-in: included by Adafruit GFX, but not used by the rendering.
@@ -0,0 +1,100 @@
+#pragma once
+
+// Host-native stand-in for Arduino core, providing only what the rendering 
+// code (and Adafruit GFX) uses. Time is simulated, see `native::setMillis`.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <algorithm>
+
+using byte = uint8_t;
+using boolean = bool;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+namespace native {
+	/// Sets simulated milliseconds counter, as returned by `millis()`.
+	void setMillis(unsigned long ms);
+	/// Advances simulated milliseconds counter.
+	void advanceMillis(unsigned long ms);
+	/// Sets simulated wall clock time, as returned by `time()`.
+	void setTime(std::time_t time);
+}
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define FPSTR(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t*>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t*>(addr))
+#define pgm_read_ptr(addr) (*reinterpret_cast<void* const*>(addr))
+#define snprintf_P snprintf
+#define sprintf_P sprintf
+#define strncasecmp_P strncasecmp
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	size_t write(const char* buffer, size_t size) {
+		return write(reinterpret_cast<const uint8_t*>(buffer), size);
+	}
+	size_t write(const char* str) {
+		return str ? write(str, std::strlen(str)) : 0;
+	}
+
+	size_t print(const char* str) { return write(str); }
+	size_t print(const __FlashStringHelper* str) { return print(reinterpret_cast<const char*>(str)); }
+	size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+	size_t print(int value);
+	size_t println(const char* str = "");
+	size_t println(const __FlashStringHelper* str) { return println(reinterpret_cast<const char*>(str)); }
+	size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+	size_t printf_P(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+protected:
+	size_t vprintf(const char* format, va_list args);
+};
+
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual int read(uint8_t* buffer, size_t size);
+	virtual size_t readBytes(char* buffer, size_t size);
+	size_t readBytes(uint8_t* buffer, size_t size) {
+		return readBytes(reinterpret_cast<char*>(buffer), size);
+	}
+};
+
+/// Serial port stand-in, writing to standard error output (so logs don't mix with tool outputs).
+class HardwareSerial : public Stream {
+public:
+	void begin(unsigned long) {}
+	size_t write(uint8_t c) override;
+	size_t write(const uint8_t* buffer, size_t size) override;
+	using Print::write;
+	int available() override { return 0; }
+	int read() override { return -1; }
+	int peek() override { return -1; }
+};
+extern HardwareSerial Serial;
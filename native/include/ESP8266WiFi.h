@@ -0,0 +1,15 @@
+#pragma once
+
+// Host-native stand-in, only for network related types used in settings.
+
+#include <Arduino.h>
+
+struct ip4_addr_t {
+	uint32_t addr;
+};
+
+struct ip_info {
+	ip4_addr_t ip;
+	ip4_addr_t netmask;
+	ip4_addr_t gw;
+};
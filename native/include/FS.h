@@ -0,0 +1,63 @@
+#pragma once
+
+// Host-native stand-in for ESP8266 file system API, backed by a directory
+// on the host (see `FS::setRoot`). Only what the rendering and history code uses.
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+enum SeekMode {
+	SeekSet = 0,
+	SeekCur = 1,
+	SeekEnd = 2,
+};
+
+class File : public Stream {
+	struct Impl;
+	std::shared_ptr<Impl> impl; // shared like handles of the real API
+
+public:
+	File() {}
+	File(std::shared_ptr<Impl> impl) : impl(std::move(impl)) {}
+
+	size_t write(uint8_t c) override;
+	size_t write(const uint8_t* buffer, size_t size) override;
+	using Print::write;
+	int available() override;
+	int read() override;
+	int peek() override;
+	int read(uint8_t* buffer, size_t size) override;
+	size_t readBytes(char* buffer, size_t size) override;
+	using Stream::readBytes;
+
+	bool seek(uint32_t position, SeekMode mode = SeekSet);
+	size_t position() const;
+	size_t size() const;
+	bool truncate(uint32_t size);
+	void close();
+	operator bool() const;
+	bool isFile() const;
+	bool isDirectory() const;
+	const char* name() const;
+	const char* fullName() const;
+
+	friend class FS;
+};
+
+class FS {
+	std::string root = ".";
+
+	std::string hostPath(const char* path) const;
+
+public:
+	/// Sets host directory to be used as root of the file system.
+	void setRoot(const char* directory) { root = directory; }
+
+	bool begin() { return true; }
+	File open(const char* path, const char* mode);
+	bool exists(const char* path);
+	bool remove(const char* path);
+	bool rename(const char* from, const char* to);
+	bool mkdir(const char* path);
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <FS.h>
+
+extern FS LittleFS;
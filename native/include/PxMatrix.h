@@ -0,0 +1,38 @@
+#pragma once
+
+// Host-native stand-in for PxMatrix display driver: plain RGB565 software
+// framebuffer, which can be inspected or saved after rendering.
+
+#include <Adafruit_GFX.h>
+#include <vector>
+
+class PxMATRIX : public Adafruit_GFX {
+	std::vector<uint16_t> buffer;
+	uint32_t pixelsWritten = 0;
+
+public:
+	PxMATRIX(uint16_t width, uint16_t height, uint8_t LATCH, uint8_t OE, uint8_t A, uint8_t B, uint8_t C = 0, uint8_t D = 0, uint8_t E = 0)
+		: Adafruit_GFX(width, height), buffer(static_cast<size_t>(width) * height)
+	{}
+
+	void begin(uint8_t rowPattern = 16) {}
+	void setFastUpdate(bool) {}
+	void setBrightness(uint8_t) {}
+	void display(uint16_t showTime = 0) {}
+	void showBuffer() {}
+	void clearDisplay() { std::fill(buffer.begin(), buffer.end(), 0); }
+
+	void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+		drawPixelRGB565(x, y, color);
+	}
+	void drawPixelRGB565(int16_t x, int16_t y, uint16_t color) {
+		if (x < 0 || y < 0 || x >= width() || y >= height()) return;
+		buffer[y * width() + x] = color;
+		pixelsWritten += 1;
+	}
+
+	/// Framebuffer, RGB565 pixels with rows ordered top-to-bottom.
+	const uint16_t* getBuffer() const { return buffer.data(); }
+	/// Number of pixels written since creation, to measure how much is pushed.
+	uint32_t getPixelsWritten() const { return pixelsWritten; }
+};
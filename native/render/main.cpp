@@ -0,0 +1,163 @@
+// Host-native tool rendering pages to BMP files, using the same rendering 
+// code as the device, with stand-ins for display and file system.
+//
+// Usage: render <data directory> <output.bmp> [options...]
+//   --page <id>            page to be rendered (default 0)
+//   --time <epoch>         simulated wall clock time, in seconds (default 0)
+//   --tz <TZ>              time zone, in POSIX TZ format (default UTC)
+//   --temperature <°C>     simulated temperature (default 21.5)
+//   --updates <count>      number of display updates (default 1)
+//   --step <ms>            simulated time between the updates (default 0)
+//   --compare <golden.bmp> compare output with golden image, exit code 2 if differs
+//
+// Outputs are 16 bits RGB565 BMP files, as used for assets.
+
+#include "common.hpp"
+#include "bitmap.hpp"
+#include "Compositor.hpp"
+#include "TimeService.hpp"
+#include "pages/Renderer.hpp"
+#include <fstream>
+#include <vector>
+
+PxMATRIX display(MATRIX_WIDTH, MATRIX_HEIGHT, 0, 0, 0, 0);
+Compositor compositor(MATRIX_WIDTH, MATRIX_HEIGHT);
+float temperature = 21.5f;
+
+namespace {
+
+bool writeBitmap(const char* path, const uint16_t* pixels, int16_t width, int16_t height) {
+	std::ofstream output(path, std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+
+	const size_t rowLengthInBytes = width * sizeof(uint16_t);
+	const size_t rowPadding = (rowLengthInBytes % 4 > 0) ? (4 - rowLengthInBytes % 4) : 0;
+	BMP::Headers headers;
+	std::memset(static_cast<void*>(&headers), 0, sizeof(headers)); // DIB header constructor leaves fields uninitialized
+	headers.fileHeader.signature = BMP::expectedSignature;
+	headers.fileHeader.offsetToPixelArray = sizeof(headers);
+	headers.dibHeader.headerSize = 40; // BITMAPINFOHEADER, for Windows to understand it
+	headers.dibHeader.width = width;
+	headers.dibHeader.height = height;
+	headers.dibHeader.planes = 1;
+	headers.dibHeader.bitPerPixel = 16;
+	headers.dibHeader.compression = 3; // BI_BITFIELDS
+	headers.dibHeader.imageSize = (rowLengthInBytes + rowPadding) * height;
+	headers.dibHeader.redMask = 0xF800;
+	headers.dibHeader.greenMask = 0x07E0;
+	headers.dibHeader.blueMask = 0x001F;
+	headers.fileHeader.size = sizeof(headers) + headers.dibHeader.imageSize;
+	output.write(reinterpret_cast<const char*>(&headers), sizeof(headers));
+
+	// Rows are stored bottom-to-top per BMP standard
+	const char padding[4] = {};
+	for (int16_t y = height - 1; y >= 0; y--) {
+		output.write(reinterpret_cast<const char*>(pixels + y * width), rowLengthInBytes);
+		output.write(padding, rowPadding);
+	}
+	return output.good();
+}
+
+bool readBitmap(const char* path, std::vector<uint16_t>& pixels, int16_t& width, int16_t& height) {
+	std::ifstream input(path, std::ios::binary);
+	BMP::Headers headers;
+	if (!input.read(reinterpret_cast<char*>(&headers), sizeof(headers)) 
+		|| headers.fileHeader.signature != BMP::expectedSignature
+		|| headers.dibHeader.bitPerPixel != 16
+		|| headers.dibHeader.height <= 0
+	) {
+		return false;
+	}
+	width = headers.width();
+	height = headers.height();
+	const size_t rowLengthInBytes = width * sizeof(uint16_t);
+	const size_t rowPadding = (rowLengthInBytes % 4 > 0) ? (4 - rowLengthInBytes % 4) : 0;
+	pixels.resize(static_cast<size_t>(width) * height);
+	input.seekg(headers.fileHeader.offsetToPixelArray);
+	for (int16_t y = height - 1; y >= 0; y--) {
+		input.read(reinterpret_cast<char*>(pixels.data() + y * width), rowLengthInBytes);
+		input.ignore(rowPadding);
+	}
+	return input.good();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::fprintf(stderr, "Usage: %s <data directory> <output.bmp> [options...]\n", argv[0]);
+		return 1;
+	}
+	const char* dataDirectory = argv[1];
+	const char* outputPath = argv[2];
+	const char* comparePath = nullptr;
+	uint8_t page = 0;
+	unsigned updates = 1;
+	unsigned long step = 0;
+	std::time_t time = 0;
+	const char* tz = "UTC0";
+	for (int i = 3; i + 1 < argc; i += 2) {
+		const std::string option = argv[i];
+		const char* value = argv[i + 1];
+		/**/ if (option == "--page")        page = static_cast<uint8_t>(std::atoi(value));
+		else if (option == "--time")        time = static_cast<std::time_t>(std::atoll(value));
+		else if (option == "--tz")          tz = value;
+		else if (option == "--temperature") temperature = static_cast<float>(std::atof(value));
+		else if (option == "--updates")     updates = static_cast<unsigned>(std::atoi(value));
+		else if (option == "--step")        step = std::strtoul(value, nullptr, 10);
+		else if (option == "--compare")     comparePath = value;
+		else {
+			std::fprintf(stderr, "Unknown option '%s'\n", option.c_str());
+			return 1;
+		}
+	}
+
+	setenv("TZ", tz, 1);
+	tzset();
+	native::setTime(time);
+	LittleFS.setRoot(dataDirectory);
+
+	TimeService::update();
+	pages::setup();
+	pages::changeActivePage(page);
+	for (unsigned i = 0; i < updates; i++) {
+		if (i > 0) {
+			native::advanceMillis(step);
+		}
+		TimeService::update();
+		pages::updatePagesStuff();
+	}
+
+	if (!writeBitmap(outputPath, display.getBuffer(), display.width(), display.height())) {
+		std::fprintf(stderr, "Failed to write '%s'\n", outputPath);
+		return 1;
+	}
+	std::printf("Rendered page %u to '%s' (%u pixels pushed)\n", page, outputPath, display.getPixelsWritten());
+
+	if (comparePath) {
+		std::vector<uint16_t> golden;
+		int16_t width, height;
+		if (!readBitmap(comparePath, golden, width, height)) {
+			std::fprintf(stderr, "Failed to read golden image '%s'\n", comparePath);
+			return 1;
+		}
+		if (width != display.width() || height != display.height()) {
+			std::printf("Golden image size differs: %dx%d\n", width, height);
+			return 2;
+		}
+		unsigned differences = 0;
+		for (size_t i = 0; i < golden.size(); i++) {
+			if (golden[i] != display.getBuffer()[i]) {
+				differences += 1;
+			}
+		}
+		if (differences) {
+			std::printf("%u pixels differ from golden image '%s'\n", differences, comparePath);
+			return 2;
+		}
+		std::printf("Matches golden image '%s'\n", comparePath);
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <Arduino.h>
+#include <coredecls.h>
+
+namespace {
+	unsigned long simulatedMillis = 0;
+	std::time_t simulatedTime = 0;
+}
+
+unsigned long millis() { return simulatedMillis; }
+unsigned long micros() { return simulatedMillis * 1000; }
+void delay(unsigned long ms) { simulatedMillis += ms; }
+void yield() {}
+
+namespace native {
+	void setMillis(unsigned long ms) { simulatedMillis = ms; }
+	void advanceMillis(unsigned long ms) { simulatedMillis += ms; }
+	void setTime(std::time_t time) { simulatedTime = time; }
+}
+
+// Replaces C library `time`, so the rendering code (using `std::time`) sees 
+// simulated wall clock, advancing along the simulated milliseconds counter.
+extern "C" std::time_t time(std::time_t* output) {
+	const std::time_t now = simulatedTime + static_cast<std::time_t>(simulatedMillis / 1000);
+	if (output) {
+		*output = now;
+	}
+	return now;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+	size_t n = 0;
+	while (size--) {
+		n += write(*buffer++);
+	}
+	return n;
+}
+
+size_t Print::print(int value) {
+	return printf("%d", value);
+}
+
+size_t Print::println(const char* str) {
+	return print(str) + print('\n');
+}
+
+size_t Print::vprintf(const char* format, va_list args) {
+	char buffer[256];
+	int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+	if (length < 0) {
+		return 0;
+	}
+	return write(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+}
+
+size_t Print::printf(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	size_t n = vprintf(format, args);
+	va_end(args);
+	return n;
+}
+
+size_t Print::printf_P(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	size_t n = vprintf(format, args);
+	va_end(args);
+	return n;
+}
+
+int Stream::read(uint8_t* buffer, size_t size) {
+	return static_cast<int>(readBytes(buffer, size));
+}
+
+size_t Stream::readBytes(char* buffer, size_t size) {
+	size_t n = 0;
+	for (; n < size; n++) {
+		int c = read();
+		if (c < 0) break;
+		buffer[n] = static_cast<char>(c);
+	}
+	return n;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+	return std::fputc(c, stderr) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+	return std::fwrite(buffer, 1, size, stderr);
+}
+
+HardwareSerial Serial;
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint32_t crc32(const void* data, size_t length, uint32_t crc) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	while (length--) {
+		crc ^= *bytes++;
+		for (uint8_t i = 0; i < 8; i++) {
+			crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+		}
+	}
+	return crc;
+}
@@ -0,0 +1,147 @@
+#include <FS.h>
+#include <LittleFS.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct File::Impl {
+	std::FILE* handle = nullptr; // null for directories
+	std::string path; // as in the file system
+	std::string name; // last path component
+	bool directory = false;
+
+	~Impl() {
+		if (handle) std::fclose(handle);
+	}
+};
+
+size_t File::write(uint8_t c) {
+	return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+	if (!impl || !impl->handle) return 0;
+	return std::fwrite(buffer, 1, size, impl->handle);
+}
+
+int File::available() {
+	if (!impl || !impl->handle) return 0;
+	return static_cast<int>(size() - position());
+}
+
+int File::read() {
+	if (!impl || !impl->handle) return -1;
+	return std::fgetc(impl->handle);
+}
+
+int File::peek() {
+	if (!impl || !impl->handle) return -1;
+	int c = std::fgetc(impl->handle);
+	if (c != EOF) std::ungetc(c, impl->handle);
+	return c;
+}
+
+int File::read(uint8_t* buffer, size_t size) {
+	return static_cast<int>(readBytes(reinterpret_cast<char*>(buffer), size));
+}
+
+size_t File::readBytes(char* buffer, size_t size) {
+	if (!impl || !impl->handle) return 0;
+	return std::fread(buffer, 1, size, impl->handle);
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+	if (!impl || !impl->handle) return false;
+	const int whence = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+	return std::fseek(impl->handle, static_cast<long>(position), whence) == 0;
+}
+
+size_t File::position() const {
+	if (!impl || !impl->handle) return 0;
+	return static_cast<size_t>(std::ftell(impl->handle));
+}
+
+size_t File::size() const {
+	if (!impl || !impl->handle) return 0;
+	std::fflush(impl->handle); // include buffered writes
+	struct stat info;
+	if (fstat(fileno(impl->handle), &info) != 0) return 0;
+	return static_cast<size_t>(info.st_size);
+}
+
+bool File::truncate(uint32_t size) {
+	if (!impl || !impl->handle) return false;
+	std::fflush(impl->handle);
+	return ftruncate(fileno(impl->handle), static_cast<off_t>(size)) == 0;
+}
+
+void File::close() {
+	impl.reset();
+}
+
+File::operator bool() const {
+	return static_cast<bool>(impl);
+}
+
+bool File::isFile() const {
+	return impl && !impl->directory;
+}
+
+bool File::isDirectory() const {
+	return impl && impl->directory;
+}
+
+const char* File::name() const {
+	return impl ? impl->name.c_str() : "";
+}
+
+const char* File::fullName() const {
+	return impl ? impl->path.c_str() : "";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string FS::hostPath(const char* path) const {
+	return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char* path, const char* mode) {
+	const std::string hostPath = this->hostPath(path);
+	auto impl = std::make_shared<File::Impl>();
+	impl->path = path;
+	const char* slash = std::strrchr(path, '/');
+	impl->name = slash ? slash + 1 : path;
+
+	struct stat info;
+	if (mode[0] == 'r' && stat(hostPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+		impl->directory = true;
+		return File(impl);
+	}
+
+	// Always binary, as on the device
+	std::string hostMode = mode;
+	hostMode += 'b';
+	impl->handle = std::fopen(hostPath.c_str(), hostMode.c_str());
+	if (!impl->handle) {
+		return File();
+	}
+	return File(impl);
+}
+
+bool FS::exists(const char* path) {
+	struct stat info;
+	return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char* path) {
+	return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+	return std::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+	return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+FS LittleFS;
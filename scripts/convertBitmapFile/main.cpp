@@ -1,6 +1,9 @@
 #include <iostream>
 #include <fstream>
 #include <cstdint>
+#include <string>
+#include <algorithm>
+#include <vector>
 #include "endianness.hpp"
 
 #pragma pack(push, 1)
@@ -33,9 +36,260 @@ struct BITMAPV2INFOHEADER : BITMAPINFOHEADER {
 	uint32_t greenMask;
 	uint32_t blueMask;
 };
+
+// Packed multi-frame animation container (see `src/packed.hpp`)
+struct PackedHeader {
+	static constexpr uint8_t hasDeltaFrames = 1 << 0;
+
+	uint16_t signature = 0x4B50; // 'PK'
+	uint8_t version = 1;
+	uint8_t flags = 0;
+	uint16_t width;
+	uint16_t height;
+	uint16_t frameCount;
+	uint16_t reserved = 0;
+};
+struct PackedFrameEntry {
+	static constexpr uint16_t isDelta = 1 << 0;
+
+	uint32_t offset;
+	uint32_t size;
+	uint16_t duration;
+	uint16_t flags = 0;
+};
+struct PackedDeltaRect {
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+};
 #pragma pack(pop)
 
+/// Reads 16 or 24 bits BMP file as RGB565 pixels, with rows ordered top-to-bottom.
+bool readBitmap(const std::string& path, int32_t& width, int32_t& height, std::vector<uint16_t>& pixels) {
+	std::ifstream input(path, std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+
+	BITMAPFILEHEADER fileHeader;
+	BITMAPINFOHEADER dibHeader;
+	input.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+	input.read(reinterpret_cast<char*>(&dibHeader), sizeof(dibHeader));
+	if (!input || fileHeader.signature != 0x4D42) {
+		std::cerr << path << ": BMP signature expected." << std::endl;
+		return false;
+	}
+	if (dibHeader.width <= 0 || dibHeader.height <= 0) {
+		std::cerr << path << ": Invalid width or height." << std::endl;
+		return false;
+	}
+	const int32_t bytesPerPixel = dibHeader.bitPerPixel / 8;
+	if (bytesPerPixel == 3 && dibHeader.compression == 3) {
+		std::cerr << path << ": Bitmaps with alpha can't be packed." << std::endl;
+		return false;
+	}
+	if (bytesPerPixel != 2 && bytesPerPixel != 3) {
+		std::cerr << path << ": 16 or 24 bits per pixel expected." << std::endl;
+		return false;
+	}
+	width = dibHeader.width;
+	height = dibHeader.height;
+
+	const size_t rowLength = static_cast<size_t>(width) * bytesPerPixel;
+	const size_t rowPadding = (rowLength % 4 > 0) ? (4 - rowLength % 4) : 0;
+	std::vector<uint8_t> row(rowLength + rowPadding);
+	pixels.resize(static_cast<size_t>(width) * height);
+	input.seekg(fileHeader.offsetToPixelArray);
+	for (int32_t y = height - 1; y >= 0; y--) { // stored bottom-to-top
+		if (!input.read(reinterpret_cast<char*>(row.data()), rowLength)) {
+			std::cerr << path << ": Data exhausted before expected end." << std::endl;
+			return false;
+		}
+		input.ignore(rowPadding);
+		for (int32_t x = 0; x < width; x++) {
+			const uint8_t* p = &row[x * bytesPerPixel];
+			uint16_t rgb565;
+			if (bytesPerPixel == 2) {
+				rgb565 = static_cast<uint16_t>(p[0] | (p[1] << 8));
+			}
+			else {
+				rgb565 = static_cast<uint16_t>(((p[2] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[0] >> 3));
+			}
+			pixels[y * width + x] = rgb565;
+		}
+	}
+	return true;
+}
+
+/// \brief Encodes frame as delta relative to previous one: changed pixels 
+/// are grouped into row spans (bridging gaps cheaper than new rectangle),
+/// and spans overlapping ones from previous row are merged into rectangles.
+std::vector<uint8_t> encodeDelta(const PackedHeader& header, const std::vector<uint16_t>& previous, const std::vector<uint16_t>& current) {
+	constexpr int32_t maxGap = sizeof(PackedDeltaRect) / sizeof(uint16_t);
+	const int32_t width = header.width;
+	const int32_t height = header.height;
+
+	std::vector<PackedDeltaRect> rects;
+	std::vector<size_t> open; // indices of rectangles reaching previous row
+	for (int32_t y = 0; y < height; y++) {
+		std::vector<size_t> stillOpen;
+		for (int32_t x = 0; x < width; x++) {
+			if (previous[y * width + x] == current[y * width + x]) {
+				continue;
+			}
+			// Find span, bridging small gaps
+			int32_t end = x + 1;
+			for (int32_t gap = 0, i = end; i < width && gap <= maxGap; i++) {
+				if (previous[y * width + i] != current[y * width + i]) {
+					end = i + 1;
+					gap = 0;
+				}
+				else {
+					gap++;
+				}
+			}
+			// Merge with overlapping rectangle from previous row, or start new one
+			bool merged = false;
+			for (size_t index : open) {
+				auto& rect = rects[index];
+				if (rect.x < end && x < rect.x + rect.width) {
+					const int32_t x0 = std::min<int32_t>(rect.x, x);
+					const int32_t x1 = std::max<int32_t>(rect.x + rect.width, end);
+					rect.x = static_cast<uint16_t>(x0);
+					rect.width = static_cast<uint16_t>(x1 - x0);
+					rect.height = static_cast<uint16_t>(y - rect.y + 1);
+					if (std::find(stillOpen.begin(), stillOpen.end(), index) == stillOpen.end()) {
+						stillOpen.push_back(index);
+					}
+					merged = true;
+					break;
+				}
+			}
+			if (!merged) {
+				rects.push_back({ static_cast<uint16_t>(x), static_cast<uint16_t>(y), static_cast<uint16_t>(end - x), 1 });
+				stillOpen.push_back(rects.size() - 1);
+			}
+			x = end;
+		}
+		open = std::move(stillOpen);
+	}
+
+	std::vector<uint8_t> data;
+	const uint16_t count = static_cast<uint16_t>(rects.size());
+	data.insert(data.end(), reinterpret_cast<const uint8_t*>(&count), reinterpret_cast<const uint8_t*>(&count) + sizeof(count));
+	for (const auto& rect : rects) {
+		data.insert(data.end(), reinterpret_cast<const uint8_t*>(&rect), reinterpret_cast<const uint8_t*>(&rect) + sizeof(rect));
+		for (int32_t y = rect.y; y < rect.y + rect.height; y++) {
+			const uint16_t* row = &current[y * width + rect.x];
+			data.insert(data.end(), reinterpret_cast<const uint8_t*>(row), reinterpret_cast<const uint8_t*>(row + rect.width));
+		}
+	}
+	return data;
+}
+
+/// \brief Packs directory of numbered BMP files (`0.bmp`, `1.bmp`, ...) into
+/// single packed animation container file.
+/// Usage: `--pack [--delta] <input directory> <output file> [frame durations in ms...]`
+/// If less durations than frames are given, the last one is repeated 
+/// (no durations given means 0, so the sprite/page duration is used).
+/// With `--delta`, frames are stored as changes relative to previous frame,
+/// unless it would not be smaller (first frame is always stored whole).
+int pack(int argc, char* argv[]) {
+	const bool delta = argc > 0 && std::string(argv[0]) == "--delta";
+	if (delta) {
+		argc--;
+		argv++;
+	}
+	if (argc < 2) {
+		std::cerr << "Usage: --pack [--delta] <input directory> <output file> [durations...]" << std::endl;
+		return 1;
+	}
+	const std::string directory = argv[0];
+
+	PackedHeader header;
+	std::vector<std::vector<uint16_t>> frames;
+	for (;;) {
+		int32_t width, height;
+		std::vector<uint16_t> pixels;
+		const std::string path = directory + "/" + std::to_string(frames.size()) + ".bmp";
+		if (!std::ifstream(path).good()) {
+			break;
+		}
+		if (!readBitmap(path, width, height, pixels)) {
+			return 1;
+		}
+		if (frames.empty()) {
+			header.width = static_cast<uint16_t>(width);
+			header.height = static_cast<uint16_t>(height);
+		}
+		else if (width != header.width || height != header.height) {
+			std::cerr << path << ": All frames should have the same size." << std::endl;
+			return 1;
+		}
+		frames.push_back(std::move(pixels));
+	}
+	if (frames.empty() || frames.size() > 255) {
+		std::cerr << "Expected 1 to 255 frames, found " << frames.size() << "." << std::endl;
+		return 1;
+	}
+	header.frameCount = static_cast<uint16_t>(frames.size());
+
+	std::ofstream output(argv[1], std::ios::binary);
+	if (!output.is_open()) {
+		std::cerr << "Error opening files." << std::endl;
+		return 1;
+	}
+
+	// Encode frames data
+	const uint32_t frameSize = static_cast<uint32_t>(header.width) * header.height * sizeof(uint16_t);
+	std::vector<std::vector<uint8_t>> datas;
+	std::vector<PackedFrameEntry> entries;
+	uint32_t offset = sizeof(PackedHeader) + header.frameCount * sizeof(PackedFrameEntry);
+	uint16_t duration = 0;
+	for (size_t i = 0; i < frames.size(); i++) {
+		if (2 + i < static_cast<size_t>(argc)) {
+			duration = static_cast<uint16_t>(std::stoul(argv[2 + i]));
+		}
+		PackedFrameEntry entry;
+		entry.duration = duration;
+		std::vector<uint8_t> data;
+		if (delta && i > 0) {
+			data = encodeDelta(header, frames[i - 1], frames[i]);
+		}
+		if (!data.empty() && data.size() < frameSize) {
+			entry.flags |= PackedFrameEntry::isDelta;
+			header.flags |= PackedHeader::hasDeltaFrames;
+		}
+		else {
+			const auto* bytes = reinterpret_cast<const uint8_t*>(frames[i].data());
+			data.assign(bytes, bytes + frameSize);
+		}
+		entry.offset = offset;
+		entry.size = static_cast<uint32_t>(data.size());
+		offset += entry.size;
+		entries.push_back(entry);
+		datas.push_back(std::move(data));
+	}
+
+	output.write(reinterpret_cast<char*>(&header), sizeof(header));
+	for (auto& entry : entries) {
+		output.write(reinterpret_cast<char*>(&entry), sizeof(entry));
+	}
+	for (const auto& data : datas) {
+		output.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	std::cout << "Packed " << frames.size() << " frames of " 
+		<< header.width << "x" << header.height << " into " << offset << " bytes." << std::endl;
+	return 0;
+}
+
 int main(int argc, char* argv[]) {
+	if (argc > 1 && std::string(argv[1]) == "--pack") {
+		return pack(argc - 2, argv + 2);
+	}
+
 	std::ifstream input(argc > 1 ? argv[1] : "input.bmp", std::ios::binary);
 	std::ofstream output(argc > 2 ? argv[2] : "output.bmp", std::ios::binary);
 
@@ -56,14 +310,19 @@ int main(int argc, char* argv[]) {
 	input.read(reinterpret_cast<char*>(&headerSize), sizeof(headerSize));
 	switch (headerSize) {
 		case 40:
-		case 52: {
+		case 52:
+		case 56:
+		case 108:
+		case 124: {
 			std::cout << "Header size: " << headerSize << std::endl;
 			
-			// Read remaining fields (aside from header size)
+			// Read remaining fields (aside from header size), including masks
+			// (following basic header if bit fields are used), ignoring newer ones
 			input.read(
 				reinterpret_cast<char*>(&headerSize) + sizeof(headerSize), 
-				headerSize - sizeof(headerSize)
+				sizeof(dibHeader) - sizeof(headerSize)
 			);
+			input.seekg(fileHeader.offsetToPixelArray);
 			break;
 		}
 		default: {
@@ -88,20 +347,33 @@ int main(int argc, char* argv[]) {
 		std::cerr << "Top-to-bottom rows order not supported." << std::endl;
 		return 1;
 	}
-	if (dibHeader.bitPerPixel != 24) {
-		std::cerr << "24 bits per pixel expected, other not supported." << std::endl;
+	// 32 bits (with alpha) are converted to RGB565 followed by 8 bits alpha (RGB565A8)
+	const size_t inputBytesPerPixel = dibHeader.bitPerPixel / 8;
+	const size_t outputBytesPerPixel = inputBytesPerPixel == 4 ? 3 : 2;
+	if (dibHeader.bitPerPixel != 24 && dibHeader.bitPerPixel != 32) {
+		std::cerr << "24 or 32 bits per pixel expected, other not supported." << std::endl;
+		return 1;
+	}
+	if (dibHeader.compression == 3 && dibHeader.bitPerPixel == 32 && (dibHeader.redMask != 0x00FF0000 
+		|| dibHeader.greenMask != 0x0000FF00 || dibHeader.blueMask != 0x000000FF)
+	) {
+		std::cerr << "Only BGRA channels order is supported." << std::endl;
 		return 1;
 	}
-	if (dibHeader.compression != 0) {
+	if (dibHeader.compression != 0 && !(dibHeader.compression == 3 && dibHeader.bitPerPixel == 32)) {
 		std::cerr << "Compression is not supported." << std::endl;
 		return 1;
 	}
+	if (outputBytesPerPixel == 3) {
+		std::cout << "Alpha: yes" << std::endl;
+	}
 
 	// Update BMP header for the output file
-	dibHeader.imageSize = (dibHeader.width * dibHeader.height) * 2; // 16 bits
+	dibHeader.headerSize = 40;
+	dibHeader.imageSize = (dibHeader.width * dibHeader.height) * outputBytesPerPixel;
 	fileHeader.offsetToPixelArray = sizeof(fileHeader) + sizeof(dibHeader);
 	fileHeader.size = fileHeader.offsetToPixelArray + dibHeader.imageSize; // TODO: should it include padding?
-	dibHeader.bitPerPixel = 16;
+	dibHeader.bitPerPixel = outputBytesPerPixel * 8;
 	dibHeader.compression = 3; // signal RGB masks should be used (BI_BITFIELDS)
 	dibHeader.redMask = 0xF800;
 	dibHeader.greenMask = 0x07E0;
@@ -112,33 +384,36 @@ int main(int argc, char* argv[]) {
 	output.write(reinterpret_cast<char*>(&dibHeader), sizeof(dibHeader));
 
 	// Convert and write pixel data
-	const size_t inputRowLength = static_cast<size_t>(dibHeader.width) * 3; // 24 bits
+	const size_t inputRowLength = static_cast<size_t>(dibHeader.width) * inputBytesPerPixel;
 	const size_t inputRowPadding = (inputRowLength % 4 > 0) ? (4 - inputRowLength % 4) : 0; // align to 4 bytes
-	const size_t outputRowLength = static_cast<size_t>(dibHeader.width) * 2; // 16 bits
+	const size_t outputRowLength = static_cast<size_t>(dibHeader.width) * outputBytesPerPixel;
 	const size_t outputRowPadding = (outputRowLength % 4 > 0) ? (4 - outputRowLength % 4) : 0; // align to 4 bytes
-	const std::string outputRowPaddingString = std::string(outputRowLength, 'A');
+	const std::string outputRowPaddingString = std::string(outputRowPadding, '\0');
 	struct {
 		uint8_t b;
 		uint8_t g;
 		uint8_t r;
-	} rgb888be;
-	uint16_t rgb565;
+		uint8_t a;
+	} bgra;
 	for (int32_t y = 0; y < dibHeader.height; y++) {
 		for (int32_t x = 0; x < dibHeader.width; x++) {
-			// Read RGB888 (24 bits)
-			if (!input.read(reinterpret_cast<char*>(&rgb888be), sizeof(rgb888be))) {
+			// Read RGB888 (24 bits), or with alpha (32 bits)
+			if (!input.read(reinterpret_cast<char*>(&bgra), inputBytesPerPixel)) {
 				std::cerr << "Data exhausted before expected end." << std::endl;
 				return 1;
 			}
 
-			// Convert to RGB565 (16 bits)
-			uint16_t r = static_cast<uint16_t>(rgb888be.r >> 3);
-			uint16_t g = static_cast<uint16_t>(rgb888be.g >> 2);
-			uint16_t b = static_cast<uint16_t>(rgb888be.b >> 3);
-			rgb565 = ((r << 11) | (g << 5) | b);
+			// Convert to RGB565 (16 bits), followed by alpha if any
+			uint16_t r = static_cast<uint16_t>(bgra.r >> 3);
+			uint16_t g = static_cast<uint16_t>(bgra.g >> 2);
+			uint16_t b = static_cast<uint16_t>(bgra.b >> 3);
+			const uint16_t rgb565 = ((r << 11) | (g << 5) | b);
+			const uint8_t converted[3] = { 
+				static_cast<uint8_t>(rgb565), static_cast<uint8_t>(rgb565 >> 8), bgra.a 
+			};
 
 			// Write the converted pixel to the output file
-			output.write(reinterpret_cast<char*>(&rgb565), sizeof(rgb565));
+			output.write(reinterpret_cast<const char*>(converted), outputBytesPerPixel);
 		}
 
 		// Add row padding to output
@@ -40,6 +40,7 @@ int main(int argc, char* argv[]) {
 			.hourArrowLength = 5,
 			.minuteArrowLength = 7,
 			.secondArrowLength = 9,
+			.antialiased = true,
 		},
 		.sprites = {
 			// textSprite(32, 0, "T:"),
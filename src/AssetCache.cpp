@@ -0,0 +1,157 @@
+#include "AssetCache.hpp"
+
+namespace {
+	inline uint32_t hashKey(const char* path, uint8_t frameIndex) {
+		uint32_t hash = (fnv1a_32(path) ^ frameIndex) * 16777619u;
+		return hash ? hash : 1; // 0 is reserved for empty entries
+	}
+}
+
+const AssetCache::Entry* AssetCache::find(const char* path, uint8_t frameIndex) {
+	const uint32_t hash = hashKey(path, frameIndex);
+	for (auto& entry : entries) {
+		if (entry.hash == hash && entry.frameIndex == frameIndex
+			&& std::strncmp(entry.path, path, maxPathLength) == 0
+		) {
+			entry.lastUsed = ++useCounter;
+			stats.hits += 1;
+			return &entry;
+		}
+	}
+	stats.misses += 1;
+	return nullptr;
+}
+
+void AssetCache::evict(Entry& entry) {
+	usedBytes -= entry.sizeInBytes();
+	delete[] entry.pixels;
+	delete[] entry.spans;
+	entry = {};
+}
+
+bool AssetCache::makeSpace(size_t required) {
+	if (required > budget) {
+		return false;
+	}
+	while (usedBytes + required > budget) {
+		Entry* oldest = nullptr;
+		for (auto& entry : entries) {
+			if (entry.hash && (!oldest || entry.lastUsed < oldest->lastUsed)) {
+				oldest = &entry;
+			}
+		}
+		if (!oldest) [[unlikely]] {
+			return false;
+		}
+		LOG_TRACE(BMP, "Evicting '%s' frame %u from cache", oldest->path, oldest->frameIndex);
+		evict(*oldest);
+		stats.evictions += 1;
+	}
+	return true;
+}
+
+AssetCache::Entry* AssetCache::allocate(const char* path, BMP::axis_index_t width, BMP::axis_index_t height, bool withAlpha) {
+	if (std::strlen(path) >= maxPathLength) {
+		return nullptr;
+	}
+
+	const size_t count = static_cast<size_t>(width) * height;
+	const size_t required = count * (sizeof(uint16_t) + (withAlpha ? 1 : 0));
+	if (!makeSpace(required)) {
+		LOG_DEBUG(BMP, "Frame of '%s' too large to cache (%u bytes)", path, static_cast<unsigned>(required));
+		return nullptr;
+	}
+
+	// Select free slot, or least recently used one
+	Entry* slot = &entries[0];
+	for (auto& entry : entries) {
+		if (!entry.hash) {
+			slot = &entry;
+			break;
+		}
+		if (entry.lastUsed < slot->lastUsed) {
+			slot = &entry;
+		}
+	}
+	if (slot->hash) {
+		evict(*slot);
+		stats.evictions += 1;
+	}
+
+	uint16_t* pixels = new (std::nothrow) uint16_t[(required + 1) / sizeof(uint16_t)];
+	if (!pixels) [[unlikely]] {
+		LOG_WARN(BMP, "Failed to allocate %u bytes for cache", static_cast<unsigned>(required));
+		return nullptr;
+	}
+	slot->width = width;
+	slot->height = height;
+	slot->pixels = pixels;
+	slot->alpha = withAlpha ? reinterpret_cast<uint8_t*>(pixels + count) : nullptr;
+	return slot;
+}
+
+const AssetCache::Entry* AssetCache::commit(Entry* slot, const char* path, uint8_t frameIndex, bool success) {
+	if (!success) [[unlikely]] {
+		delete[] slot->pixels;
+		*slot = {};
+		return nullptr;
+	}
+	slot->hash = hashKey(path, frameIndex);
+	slot->lastUsed = ++useCounter;
+	std::strcpy(slot->path, path); // length checked by `allocate`
+	slot->frameIndex = frameIndex;
+	usedBytes += slot->sizeInBytes();
+	return slot;
+}
+
+const AssetCache::Entry* AssetCache::insert(const char* path, uint8_t frameIndex, Stream& file, const BMP::Headers& headers) {
+	Entry* slot = allocate(path, headers.width(), headers.height(), headers.hasAlpha());
+	if (!slot) {
+		return nullptr;
+	}
+	return commit(slot, path, frameIndex, BMP::readPixels(file, headers, slot->pixels, slot->alpha));
+}
+
+const AssetCache::Entry* AssetCache::insert(const char* path, uint8_t frameIndex, Stream& file, const Packed::Header& header) {
+	Entry* slot = allocate(path, header.width, header.height);
+	if (!slot) {
+		return nullptr;
+	}
+	return commit(slot, path, frameIndex, Packed::readPixels(file, header, slot->pixels));
+}
+
+const uint16_t* AssetCache::opaqueSpans(const Entry* constEntry, uint16_t transparentColor) {
+	Entry& entry = entries[constEntry - entries];
+	if (entry.spans && entry.spansColor == transparentColor) {
+		return entry.spans;
+	}
+
+	usedBytes -= entry.spansSizeInBytes;
+	delete[] entry.spans;
+	entry.spansSizeInBytes = 0;
+
+	size_t sizeInBytes;
+	entry.spans = BMP::computeOpaqueSpans(entry.pixels, entry.width, entry.height, transparentColor, sizeInBytes);
+	if (!entry.spans) [[unlikely]] {
+		return nullptr;
+	}
+	entry.spansColor = transparentColor;
+	entry.spansSizeInBytes = sizeInBytes;
+	usedBytes += sizeInBytes;
+	return entry.spans;
+}
+
+void AssetCache::clear() {
+	for (auto& entry : entries) {
+		if (entry.hash) {
+			evict(entry);
+		}
+	}
+}
+
+void AssetCache::setBudget(size_t bytes) {
+	budget = bytes;
+	makeSpace(0);
+}
+
+AssetCache assetCache(assetCacheBudget);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "common.hpp"
+#include "bitmap.hpp"
+#include "packed.hpp"
+
+/// \brief Bounded cache of decoded RGB565 frames (BMP assets), keyed by
+/// resolved path and frame index. Least recently used entries are evicted
+/// when the byte budget is exceeded. Opaque spans (for drawing with
+/// transparency) are computed once per entry and kept along the pixels.
+/// Frames with alpha keep it in the same block, right after the pixels.
+class AssetCache {
+public:
+	static constexpr uint8_t maxEntries = 16;
+	static constexpr uint8_t maxPathLength = 32;
+
+	struct Entry {
+		uint32_t hash; // of path & frame index, 0 if entry is empty
+		uint32_t lastUsed; // value of use counter when entry was last used
+		char path[maxPathLength];
+		uint8_t frameIndex;
+		BMP::axis_index_t width;
+		BMP::axis_index_t height;
+		uint16_t* pixels; // top-to-bottom rows, without padding
+		uint8_t* alpha; // laid out as pixels (in the same block), or null pointer if opaque
+		uint16_t* spans; // opaque spans for `spansColor`, see `BMP::computeOpaqueSpans`
+		uint16_t spansColor; // transparent color the spans were computed for
+		uint32_t spansSizeInBytes;
+
+		inline size_t sizeInBytes() const {
+			return static_cast<size_t>(width) * height * (sizeof(uint16_t) + (alpha ? 1 : 0)) + spansSizeInBytes;
+		}
+	};
+
+	struct Stats {
+		uint32_t hits;
+		uint32_t misses;
+		uint32_t evictions;
+	};
+
+protected:
+	Entry entries[maxEntries] = {};
+	uint32_t useCounter = 0;
+	size_t budget;
+	size_t usedBytes = 0;
+	Stats stats = {};
+
+	void evict(Entry& entry);
+	bool makeSpace(size_t required);
+
+	/// \brief Allocates pixels for new entry, evicting others if necessary.
+	/// Entry is only committed (marked used) by `commit` after reading pixels.
+	Entry* allocate(const char* path, BMP::axis_index_t width, BMP::axis_index_t height, bool withAlpha = false);
+	const Entry* commit(Entry* slot, const char* path, uint8_t frameIndex, bool success);
+
+public:
+	AssetCache(size_t budget)
+		: budget(budget)
+	{}
+
+	/// \brief Finds decoded frame in the cache.
+	/// \return Cached entry, or null pointer if not found.
+	const Entry* find(const char* path, uint8_t frameIndex);
+
+	/// \brief Decodes BMP frame from the stream and puts it in the cache,
+	/// evicting least recently used entries if necessary.
+	/// \param file Stream positioned right after the headers.
+	/// \param headers Headers read from the stream.
+	/// \return Cached entry, or null pointer if frame could not be cached
+	/// (too large for the budget, allocation or read failure). Stream might be
+	/// partially consumed on read failure.
+	const Entry* insert(const char* path, uint8_t frameIndex, Stream& file, const BMP::Headers& headers);
+
+	/// \brief Reads frame from packed animation container and puts it in the cache.
+	/// \param file Stream positioned at the frame data.
+	/// \param header Header of the container.
+	/// \return Cached entry, or null pointer if frame could not be cached.
+	const Entry* insert(const char* path, uint8_t frameIndex, Stream& file, const Packed::Header& header);
+
+	/// \brief Returns opaque spans of the entry for given transparent color,
+	/// computing them if not computed already (or for other color).
+	/// \return Spans, or null pointer if they could not be computed.
+	const uint16_t* opaqueSpans(const Entry* entry, uint16_t transparentColor);
+
+	/// Removes all entries, i.e. when assets might have changed.
+	void clear();
+
+	/// Changes byte budget, evicting entries if necessary.
+	void setBudget(size_t bytes);
+
+	inline size_t getBudget() const { return budget; }
+	inline size_t getUsedBytes() const { return usedBytes; }
+	inline const Stats& getStats() const { return stats; }
+};
+
+extern AssetCache assetCache;
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm> // min, max
+
+/// \brief Gradient of colors over range of values, baked into lookup table 
+/// of RGB565 colors (entry per 0.1 of value, or coarser if the range is wide),
+/// so getting color is just index computation, instead of interpolating
+/// colors (in float HSL) every time. Table storage is provided by the owner,
+/// so gradients can share single pool.
+class ColorGradient {
+	const uint16_t* table = nullptr;
+	uint16_t count = 0;
+	int16_t start; // value of first entry, in tenths
+	uint8_t step; // tenths per entry
+
+	static inline int32_t toTenths(float value) {
+		return static_cast<int32_t>(value * 10 + (value < 0 ? -0.5f : 0.5f));
+	}
+
+public:
+	/// \brief Bakes the gradient over the range into the storage.
+	/// \param colorAt Function returning color for given value.
+	/// \return Number of entries used, 0 if there was no space.
+	template <typename ColorAt>
+	uint16_t bake(float from, float to, uint16_t* storage, uint16_t capacity, ColorAt colorAt) {
+		table = storage;
+		count = 0;
+		if (capacity == 0) {
+			return 0;
+		}
+		start = static_cast<int16_t>(toTenths(from));
+		const int32_t span = std::max<int32_t>(toTenths(to) - start, 0);
+		step = static_cast<uint8_t>(std::min<int32_t>(span / capacity + 1, UINT8_MAX));
+		// One more entry past the range, for values above it
+		count = static_cast<uint16_t>(std::min<int32_t>((span + step - 1) / step + 2, capacity));
+		for (uint16_t i = 0; i < count; i++) {
+			storage[i] = colorAt(static_cast<float>(start + i * step) / 10);
+		}
+		return count;
+	}
+
+	inline bool isBaked() const { return count != 0; }
+
+	/// Returns color for given value, from the nearest entry (clamped to the table).
+	inline uint16_t at(float value) const {
+		const int32_t offset = toTenths(value) - start;
+		if (offset <= 0) {
+			return table[0];
+		}
+		const int32_t index = (offset + step / 2) / step;
+		return table[std::min<int32_t>(index, count - 1)];
+	}
+};
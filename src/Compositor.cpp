@@ -0,0 +1,38 @@
+#include "Compositor.hpp"
+
+Compositor::Compositor(int16_t width, int16_t height)
+	: frame(width, height), backgroundPixels(new uint16_t[width * height])
+{
+	fillBackground(0);
+}
+
+Compositor::~Compositor() {
+	delete[] backgroundPixels;
+}
+
+void Compositor::fillBackground(uint16_t color) {
+	std::fill_n(backgroundPixels, width() * height(), color);
+}
+
+void Compositor::restore(const Rect& rect) {
+	const Rect area = rect.intersection(bounds());
+	if (area.isEmpty()) {
+		return;
+	}
+	const Surface background = backgroundSurface();
+	const Surface target = frameSurface();
+	for (int16_t y = area.y0; y < area.y1; y++) {
+		std::memcpy(target.row(y) + area.x0, background.row(y) + area.x0, area.width() * sizeof(uint16_t));
+	}
+}
+
+void Compositor::present(PxMATRIX& display, const Rect& rect) {
+	const Rect area = rect.intersection(bounds());
+	const Surface source = frameSurface();
+	for (int16_t y = area.y0; y < area.y1; y++) {
+		const uint16_t* row = source.row(y);
+		for (int16_t x = area.x0; x < area.x1; x++) {
+			display.drawPixelRGB565(x, y, row[x]);
+		}
+	}
+}
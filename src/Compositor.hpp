@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.hpp"
+#include "Surface.hpp"
+#define PxMATRIX_double_buffer false
+#include <PxMatrix.h>
+
+/// \brief Composes frames off-screen before pushing them to the display.
+/// Keeps pre-rendered background layer, which is used to restore areas 
+/// of the frame before sprites are drawn over it again. Finished areas
+/// of the frame are pushed to the display only when finished, so the refresh
+/// (scanning out the display buffer) never shows restored background without
+/// sprites over it. PxMatrix keeps its buffer in own bit-plane layout and
+/// exposes no bulk copy, so pushing is still done pixel by pixel, and the
+/// refresh can show an area half pushed (for single refresh only).
+class Compositor {
+	GFXcanvas16 frame; // off-screen frame buffer the sprites are drawn into
+	uint16_t* backgroundPixels; // pre-rendered background layer
+
+public:
+	Compositor(int16_t width, int16_t height);
+	~Compositor();
+
+	inline int16_t width() const { return frame.width(); }
+	inline int16_t height() const { return frame.height(); }
+	inline Rect bounds() const { return Rect::fromSize(0, 0, width(), height()); }
+
+	/// Canvas for drawing into the frame, using Adafruit GFX API.
+	inline Adafruit_GFX& canvas() { return frame; }
+	/// Frame being composed, as plain pixels buffer.
+	inline Surface frameSurface() const { return { frame.getBuffer(), width(), height() }; }
+	/// Background layer, as plain pixels buffer. 
+	inline Surface backgroundSurface() const { return { backgroundPixels, width(), height() }; }
+
+	/// Fills whole background layer with single color.
+	void fillBackground(uint16_t color);
+
+	/// Restores area of the frame from the background layer.
+	void restore(const Rect& rect);
+
+	/// Pushes area of the frame to the display (pixel by pixel, see above).
+	void present(PxMATRIX& display, const Rect& rect);
+};
@@ -0,0 +1,112 @@
+#include "DisplayRefresh.hpp"
+#include <algorithm> // max, min
+#include <cmath> // ceil
+
+namespace DisplayRefresh {
+	Config config;
+	Model costModel;
+	State current = {
+		.interval = config.interval,
+		.brightness = config.brightness,
+		.showTime = config.showTime,
+		.reason = Reason::Day,
+	};
+	bool uploading = false;
+	bool configured = false; // configuration changed since last update
+
+	struct Sample {
+		uint32_t calls;
+		uint64_t totalDuration;
+		uint32_t micros;
+	};
+	Sample previous;
+	bool hasPrevious = false;
+
+	/// Selects state for current conditions, returns true if it changed.
+	bool select(bool isNight) {
+		State next = current;
+		next.reason = uploading ? Reason::Upload : isNight ? Reason::Night : Reason::Day;
+		switch (next.reason) {
+			case Reason::Day:    next.interval = config.interval;       break;
+			case Reason::Night:  next.interval = config.nightInterval;  break;
+			case Reason::Upload: next.interval = config.uploadInterval; break;
+		}
+		next.brightness = isNight ? config.nightBrightness : config.brightness;
+		next.showTime = config.showTime;
+
+		// Slow down to fit the budget; speeding up requires some margin,
+		// so measurements noise doesn't flip the interval back and forth
+		const float budget = config.maxCpuShare / 100.0f;
+		// Configured slowest interval might not be enough (i.e. long show time),
+		// but the budget has to stay reachable, so the limit is raised then
+		const float fittingInterval = std::ceil(costModel.callDuration(next.showTime, next.brightness) / (budget * 1000));
+		const uint8_t maxInterval = static_cast<uint8_t>(std::min(std::max<float>(config.maxInterval, fittingInterval), 255.0f));
+		next.limited = false;
+		while (next.interval < maxInterval) {
+			const float allowed = next.interval < current.interval ? budget * 0.9f : budget;
+			if (costModel.cpuShare(next.showTime, next.brightness, next.interval) <= allowed) {
+				break;
+			}
+			next.interval += 1;
+			next.limited = true;
+		}
+		next.predictedCpuShare = costModel.cpuShare(next.showTime, next.brightness, next.interval);
+
+		const bool changed = next.interval != current.interval
+			|| next.brightness != current.brightness
+			|| next.showTime != current.showTime;
+		current = next;
+		return changed;
+	}
+
+	void configure(const Config& newConfig) {
+		config = newConfig;
+		config.interval = std::max<uint8_t>(config.interval, 1);
+		config.nightInterval = std::max<uint8_t>(config.nightInterval, 1);
+		config.uploadInterval = std::max<uint8_t>(config.uploadInterval, 1);
+		config.maxInterval = std::max(config.maxInterval, config.interval);
+		config.maxCpuShare = std::clamp<uint8_t>(config.maxCpuShare, 1, 100);
+		configured = true;
+	}
+
+	void setUploading(bool value) {
+		uploading = value;
+	}
+
+	bool update(uint32_t calls, uint64_t totalDuration, uint32_t nowMicros, bool isNight) {
+		if (hasPrevious && calls != previous.calls) {
+			const uint32_t elapsed = nowMicros - previous.micros;
+			const float duration = static_cast<float>(totalDuration - previous.totalDuration);
+			current.measuredCpuShare = duration / elapsed;
+
+			// Overhead is what remains from average call after the lit time,
+			// smoothed as single calls can be extended by other interrupts
+			const float average = duration / (calls - previous.calls);
+			const float lit = static_cast<float>(current.showTime) * current.brightness / 255;
+			costModel.overhead += (std::max(average - lit, 0.0f) - costModel.overhead) / 4;
+		}
+		previous = { calls, totalDuration, nowMicros };
+		hasPrevious = true;
+
+		const bool changed = select(isNight) || configured;
+		configured = false;
+		return changed;
+	}
+
+	const State& state() {
+		return current;
+	}
+
+	const Model& model() {
+		return costModel;
+	}
+
+	const char* reasonName(Reason reason) {
+		switch (reason) {
+			case Reason::Day:    return "day";
+			case Reason::Night:  return "night";
+			case Reason::Upload: return "upload";
+		}
+		return "";
+	}
+}
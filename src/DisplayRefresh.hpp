@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.hpp"
+
+/// \brief Governor of the display refresh rate. Refresh callback is run by
+/// the timer every interval, taking CPU time from everything else, so the
+/// interval is selected at runtime: slower at night and while receiving
+/// uploads, and slowed down further if the refresh would take more than
+/// configured share of CPU time. Time spent in the callback is measured,
+/// calibrating cost model, which predicts CPU share of any configuration.
+namespace DisplayRefresh {
+
+struct Config {
+	uint16_t showTime = 30; // µs, lit time per refresh, at full brightness
+	uint8_t interval = 5; // ms between refreshes
+	uint8_t nightInterval = 8; // ms between refreshes, at night
+	uint8_t uploadInterval = 10; // ms between refreshes, while receiving uploads
+	uint8_t maxInterval = 10; // ms, limit for slowing down to fit CPU share (raised if not enough)
+	uint8_t maxCpuShare = 25; // percent
+	uint8_t brightness = 127;
+	uint8_t nightBrightness = 127;
+};
+
+/// \brief Cost model of single refresh callback call: fixed part (shifting
+/// the row data out, latching) and lit time, as the driver keeps outputs
+/// enabled for brightness scaled part of the show time.
+struct Model {
+	float overhead = 40; // µs, initial guess, calibrated from measurements
+
+	inline float callDuration(uint16_t showTime, uint8_t brightness) const {
+		return overhead + static_cast<float>(showTime) * brightness / 255;
+	}
+
+	/// Predicts share (0-1) of CPU time taken by the refresh.
+	inline float cpuShare(uint16_t showTime, uint8_t brightness, uint8_t interval) const {
+		return callDuration(showTime, brightness) / (interval * 1000.0f);
+	}
+};
+
+/// Why the interval was selected.
+enum class Reason : uint8_t {
+	Day,
+	Night,
+	Upload,
+};
+
+struct State {
+	uint8_t interval; // ms
+	uint8_t brightness;
+	uint16_t showTime; // µs
+	Reason reason;
+	bool limited; // slowed down to fit CPU share
+	float measuredCpuShare; // 0-1, since previous update
+	float predictedCpuShare; // 0-1, by the model for current state
+};
+
+/// Sets configuration, to be applied on next update.
+void configure(const Config& config);
+
+/// Marks uploads as being received (or finished), so the rate can be lowered.
+void setUploading(bool uploading);
+
+/// \brief Takes measurements of the callback (counters since boot),
+/// calibrates the model and selects interval and brightness.
+/// \param calls Number of callback calls.
+/// \param totalDuration Time spent in the callback, in µs.
+/// \param nowMicros Current time, in µs.
+/// \return true if the state changed, so it should be applied
+bool update(uint32_t calls, uint64_t totalDuration, uint32_t nowMicros, bool isNight);
+
+const State& state();
+const Model& model();
+
+const char* reasonName(Reason reason);
+
+}
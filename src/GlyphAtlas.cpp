@@ -0,0 +1,193 @@
+#include "GlyphAtlas.hpp"
+
+const GlyphAtlas::Glyph* GlyphAtlas::rasterize(const GFXfont* font, uint8_t character) {
+	Glyph glyph {
+		.font = font,
+		.character = character,
+	};
+	uint8_t mask[128]; // enough for glyphs up to 32x32
+	if (font) {
+		const uint16_t first = pgm_read_word(&font->first);
+		const uint16_t last = pgm_read_word(&font->last);
+		if (character < first || character > last) {
+			return nullptr;
+		}
+		const GFXglyph* fontGlyph = static_cast<const GFXglyph*>(pgm_read_ptr(&font->glyph)) + (character - first);
+		const uint8_t* bitmap = static_cast<const uint8_t*>(pgm_read_ptr(&font->bitmap)) + pgm_read_word(&fontGlyph->bitmapOffset);
+		glyph.width = pgm_read_byte(&fontGlyph->width);
+		glyph.height = pgm_read_byte(&fontGlyph->height);
+		glyph.xOffset = pgm_read_byte(&fontGlyph->xOffset);
+		glyph.yOffset = pgm_read_byte(&fontGlyph->yOffset);
+		glyph.xAdvance = pgm_read_byte(&fontGlyph->xAdvance);
+		if (glyph.stride() * glyph.height > static_cast<int>(sizeof(mask))) [[unlikely]] {
+			LOG_WARN(Pages, "Glyph %u too large for the atlas", character);
+			return nullptr;
+		}
+
+		// Font bitmaps are continuous bits, masks have rows padded to bytes
+		memset(mask, 0, glyph.stride() * glyph.height);
+		uint16_t bitIndex = 0;
+		for (uint8_t y = 0; y < glyph.height; y++) {
+			uint8_t* row = mask + y * glyph.stride();
+			for (uint8_t x = 0; x < glyph.width; x++, bitIndex++) {
+				if (pgm_read_byte(bitmap + bitIndex / 8) & (0x80 >> (bitIndex % 8))) {
+					row[x / 8] |= 0x80 >> (x % 8);
+				}
+			}
+		}
+	}
+	else {
+		// Default font data is not exposed by the library, so the glyph is drawn into small canvas
+		static GFXcanvas1 canvas(5, 8);
+		canvas.fillScreen(0);
+		canvas.drawChar(0, 0, character, 1, 1, 1); // same background color means transparent
+		glyph.width = 5;
+		glyph.height = 8;
+		glyph.xAdvance = 6;
+		memset(mask, 0, glyph.height);
+		for (uint8_t y = 0; y < glyph.height; y++) {
+			for (uint8_t x = 0; x < glyph.width; x++) {
+				if (canvas.getPixel(x, y)) {
+					mask[y] |= 0x80 >> x;
+				}
+			}
+		}
+	}
+
+	const uint16_t maskSize = glyph.stride() * glyph.height;
+	if (count == maxGlyphs || poolUsed + maskSize > poolSize) {
+		LOG_DEBUG(Pages, "Glyph atlas full, clearing");
+		clear();
+		stats.flushes += 1;
+	}
+	glyph.maskOffset = poolUsed;
+	memcpy(pool + poolUsed, mask, maskSize);
+	poolUsed += maskSize;
+	glyphs[count] = glyph;
+	stats.misses += 1;
+	return &glyphs[count++];
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::find(const GFXfont* font, uint8_t character) {
+	for (uint8_t i = 0; i < count; i++) {
+		if (glyphs[i].character == character && glyphs[i].font == font) {
+			stats.hits += 1;
+			return &glyphs[i];
+		}
+	}
+	return rasterize(font, character);
+}
+
+template <typename Callback>
+void GlyphAtlas::layout(const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t wrapWidth, ColonTweaks tweaks, Callback callback) {
+	const uint8_t lineHeight = font ? pgm_read_byte(&font->yAdvance) : 8;
+	for (; *text; text++) {
+		const uint8_t character = *text;
+		if (character == '\n') {
+			x = 0; // as Adafruit GFX does
+			y += lineHeight;
+			continue;
+		}
+		if (character == '\r') {
+			continue;
+		}
+		const Glyph* glyph = find(font, character);
+		if (!glyph) {
+			continue;
+		}
+		if (character == ':') {
+			x -= tweaks.skipStart;
+		}
+		// Same as Adafruit GFX: whole 6 pixels cell for default font, glyph box for others
+		const bool wraps = font
+			? glyph->width && glyph->height && x + glyph->xOffset + glyph->width > wrapWidth
+			: x + glyph->xAdvance > wrapWidth;
+		if (wraps) {
+			x = 0;
+			y += lineHeight;
+		}
+		callback(*glyph, x, y);
+		x += glyph->xAdvance;
+		if (character == ':') {
+			x -= tweaks.minusAdvanceX;
+		}
+	}
+}
+
+void GlyphAtlas::fill(const Surface& target, const Glyph& glyph, int16_t x0, int16_t y0, uint16_t color, const Rect& area) {
+	const Rect clip = area.intersection(target.bounds()).intersection(Rect::fromSize(x0, y0, glyph.width, glyph.height));
+	if (clip.isEmpty()) {
+		return;
+	}
+	const uint8_t* row = mask(glyph) + (clip.y0 - y0) * glyph.stride();
+	for (int16_t ty = clip.y0; ty < clip.y1; ty++, row += glyph.stride()) {
+		uint16_t* pixels = target.row(ty);
+		// Fill spans of set bits, clipped
+		int16_t spanStart = -1;
+		for (uint8_t mx = 0; mx <= glyph.width; mx++) {
+			const bool set = mx < glyph.width && (row[mx / 8] & (0x80 >> (mx % 8)));
+			if (set) {
+				if (spanStart < 0) {
+					spanStart = mx;
+				}
+				continue;
+			}
+			if (mx % 8 == 0 && mx + 8 <= glyph.width && row[mx / 8] == 0 && spanStart < 0) {
+				mx += 7; // skip empty byte
+				continue;
+			}
+			if (spanStart >= 0) {
+				const int16_t from = std::max<int16_t>(x0 + spanStart, clip.x0);
+				const int16_t to = std::min<int16_t>(x0 + mx, clip.x1);
+				if (from < to) {
+					std::fill(pixels + from, pixels + to, color);
+				}
+				spanStart = -1;
+			}
+		}
+	}
+}
+
+void GlyphAtlas::draw(const Surface& target, const GFXfont* font, const char* text, int16_t x, int16_t y, uint16_t color, int16_t wrapWidth, const Rect& clip) {
+	layout(font, text, x, y, wrapWidth, {}, [&](const Glyph& glyph, int16_t x, int16_t y) {
+		fill(target, glyph, x + glyph.xOffset, y + glyph.yOffset, color, clip);
+	});
+}
+
+Rect GlyphAtlas::bounds(const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t wrapWidth) {
+	Rect result = Rect::fromSize(x, y, 0, 0);
+	layout(font, text, x, y, wrapWidth, {}, [&](const Glyph& glyph, int16_t x, int16_t y) {
+		result = result.united(Rect::fromSize(x + glyph.xOffset, y + glyph.yOffset, glyph.width, glyph.height));
+	});
+	return result;
+}
+
+uint8_t GlyphAtlas::layout(const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t wrapWidth, Cell* cells, uint8_t maxCells, ColonTweaks tweaks) {
+	uint8_t written = 0;
+	layout(font, text, x, y, wrapWidth, tweaks, [&](const Glyph& glyph, int16_t x, int16_t y) {
+		if (written < maxCells) {
+			cells[written++] = { x, y, glyph.character };
+		}
+	});
+	return written;
+}
+
+void GlyphAtlas::draw(const Surface& target, const GFXfont* font, const Cell& cell, uint16_t color, const Rect& clip) {
+	if (const Glyph* glyph = find(font, cell.character)) {
+		fill(target, *glyph, cell.x + glyph->xOffset, cell.y + glyph->yOffset, color, clip);
+	}
+}
+
+Rect GlyphAtlas::bounds(const GFXfont* font, const Cell& cell) {
+	if (const Glyph* glyph = find(font, cell.character)) {
+		return Rect::fromSize(cell.x + glyph->xOffset, cell.y + glyph->yOffset, glyph->width, glyph->height);
+	}
+	return Rect::fromSize(cell.x, cell.y, 0, 0);
+}
+
+void GlyphAtlas::clear() {
+	count = 0;
+	poolUsed = 0;
+}
+
+GlyphAtlas glyphAtlas;
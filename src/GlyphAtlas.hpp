@@ -0,0 +1,105 @@
+#pragma once
+
+#include "common.hpp"
+#include "Surface.hpp"
+#include <Adafruit_GFX.h> // GFXfont
+
+/// \brief Cache of glyphs rasterized once into compact 1bpp masks (rows
+/// padded to bytes, most significant bit first), so text can be drawn by
+/// filling spans of set bits, instead of walking font bitmaps and writing
+/// pixels one by one on every frame. Masks don't depend on the color, so
+/// single entry per font and character serves all colors. Layout follows
+/// Adafruit GFX `print` (text size 1, wrapping at given width), so texts
+/// end up in the same place.
+class GlyphAtlas {
+public:
+	static constexpr uint8_t maxGlyphs = 64;
+	static constexpr uint16_t poolSize = 2048;
+
+	struct Glyph {
+		const GFXfont* font; // null for default (classic 5x7) font
+		uint8_t character;
+		uint8_t width;
+		uint8_t height;
+		int8_t xOffset; // of the mask, from the cursor (baseline for custom fonts, top for the default one)
+		int8_t yOffset;
+		uint8_t xAdvance;
+		uint16_t maskOffset; // in the pool
+
+		inline uint8_t stride() const { return (width + 7) / 8; }
+	};
+
+	/// Character laid out at the pen (cursor) position, as by Adafruit GFX.
+	struct Cell {
+		int16_t x;
+		int16_t y;
+		uint8_t character;
+	};
+
+	/// \brief Tweaks of the layout for colons, to make clocks narrower: pen is
+	/// moved back before the colon (skipping its blank start) and after it.
+	struct ColonTweaks {
+		uint8_t skipStart;
+		uint8_t minusAdvanceX;
+	};
+
+	struct Stats {
+		uint32_t hits;
+		uint32_t misses; // rasterized glyphs
+		uint32_t flushes; // atlas cleared when full
+	};
+
+protected:
+	Glyph glyphs[maxGlyphs];
+	uint8_t count = 0;
+	uint8_t pool[poolSize];
+	uint16_t poolUsed = 0;
+	Stats stats = {};
+
+	/// \brief Rasterizes the glyph into the pool.
+	/// \return Added glyph, or null pointer if character is not in the font.
+	const Glyph* rasterize(const GFXfont* font, uint8_t character);
+
+	/// Calls the callback with each glyph and pen position, as laid out by Adafruit GFX.
+	template <typename Callback>
+	void layout(const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t wrapWidth, ColonTweaks tweaks, Callback callback);
+
+	/// Fills set pixels of the glyph mask placed at given position, clipped.
+	void fill(const Surface& target, const Glyph& glyph, int16_t x0, int16_t y0, uint16_t color, const Rect& area);
+
+public:
+	/// \brief Finds the glyph, rasterizing it if not cached yet.
+	/// \return Glyph, or null pointer if character is not in the font.
+	const Glyph* find(const GFXfont* font, uint8_t character);
+
+	inline const uint8_t* mask(const Glyph& glyph) const {
+		return pool + glyph.maskOffset;
+	}
+
+	/// \brief Draws the text at given cursor position (like Adafruit GFX `print`).
+	/// \param wrapWidth Width at which text wraps to next line, usually target width.
+	/// \param clip Area of the target to limit drawing to.
+	void draw(const Surface& target, const GFXfont* font, const char* text, int16_t x, int16_t y, uint16_t color, int16_t wrapWidth, const Rect& clip);
+
+	/// Returns area covered by pixels of the text drawn at given cursor position.
+	Rect bounds(const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t wrapWidth);
+
+	/// \brief Lays out the text into cells, so characters can be compared, 
+	/// and drawn or invalidated one by one.
+	/// \return Number of cells written, up to `maxCells`.
+	uint8_t layout(const GFXfont* font, const char* text, int16_t x, int16_t y, int16_t wrapWidth, Cell* cells, uint8_t maxCells, ColonTweaks tweaks = {});
+
+	/// Draws the character of the cell, clipped.
+	void draw(const Surface& target, const GFXfont* font, const Cell& cell, uint16_t color, const Rect& clip);
+
+	/// Returns area covered by pixels of the character of the cell.
+	Rect bounds(const GFXfont* font, const Cell& cell);
+
+	/// Removes all glyphs, i.e. when fonts might have changed.
+	void clear();
+
+	inline const Stats& getStats() const { return stats; }
+	inline uint16_t getUsedBytes() const { return poolUsed; }
+};
+
+extern GlyphAtlas glyphAtlas;
@@ -0,0 +1,264 @@
+#include "History.hpp"
+#include <cmath>
+#ifndef NATIVE
+#include "ResponseWriter.hpp"
+#endif
+
+namespace History {
+	uint16_t Record::calculateCheck() const {
+		return static_cast<uint16_t>(crc32(this, offsetof(Record, check)));
+	}
+
+	/// Value of raw sample slot without reading.
+	constexpr int16_t missing = INT16_MIN;
+
+	/// Raw samples, as ring indexed by slot (time divided by raw interval).
+	int16_t raw[rawCapacity];
+	uint32_t rawNewestSlot = 0; // 0 if empty
+
+	/// Aggregate of readings over period being currently collected.
+	struct Aggregate {
+		uint32_t periodStart;
+		int32_t sum;
+		uint16_t count = 0;
+		int16_t min;
+		int16_t max;
+
+		void add(int16_t minValue, int16_t avgValue, int16_t maxValue) {
+			if (count == 0) {
+				min = minValue;
+				max = maxValue;
+				sum = 0;
+			}
+			else {
+				min = std::min(min, minValue);
+				max = std::max(max, maxValue);
+			}
+			sum += avgValue;
+			count += 1;
+		}
+
+		Record toRecord() const {
+			Record record {
+				.time = periodStart,
+				.min = min,
+				.avg = static_cast<int16_t>(sum / count),
+				.max = max,
+				.check = 0,
+			};
+			record.check = record.calculateCheck();
+			return record;
+		}
+	};
+
+	Aggregate minute;
+	Aggregate hour;
+
+	void Log::append(const Record& record) {
+		pending[pendingCount++] = record;
+		if (pendingCount == maxPending) {
+			flush();
+		}
+	}
+
+	void Log::flush() {
+		if (pendingCount == 0) {
+			return;
+		}
+		File file = LittleFS.open(path, "a");
+		if (!file) {
+			LOG_ERROR(History, "Failed to open '%s' for append", path);
+			return;
+		}
+		const size_t bytes = pendingCount * sizeof(Record);
+		if (file.write(reinterpret_cast<const uint8_t*>(pending), bytes) != bytes) {
+			LOG_ERROR(History, "Failed to append to '%s'", path);
+		}
+		pendingCount = 0;
+
+		const bool tooLong = file.size() >= 2u * capacity * sizeof(Record);
+		file.close(); // opened for append only, can't be read
+		if (tooLong) {
+			compact();
+		}
+	}
+
+	void Log::compact() {
+		LOG_DEBUG(History, "Compacting '%s'", path);
+		File file = LittleFS.open(path, "r");
+		if (!file) {
+			LOG_ERROR(History, "Failed to open '%s' for compaction", path);
+			return;
+		}
+		const size_t size = file.size() / sizeof(Record) * sizeof(Record);
+		if (size <= capacity * sizeof(Record)) {
+			return;
+		}
+		File temporary = LittleFS.open(temporaryPath, "w");
+		if (!temporary) {
+			return;
+		}
+		file.seek(size - capacity * sizeof(Record));
+		uint8_t buffer[16 * sizeof(Record)];
+		size_t copied = 0;
+		while (copied < capacity * sizeof(Record)) {
+			const size_t read = file.read(buffer, std::min(sizeof(buffer), capacity * sizeof(Record) - copied));
+			if (read == 0 || temporary.write(buffer, read) != read) {
+				break;
+			}
+			copied += read;
+		}
+		temporary.close();
+		file.close();
+		if (copied != capacity * sizeof(Record)) {
+			// Keep the (longer) log rather than losing records
+			LOG_ERROR(History, "Failed to compact '%s'", path);
+			LittleFS.remove(temporaryPath);
+			return;
+		}
+		LittleFS.remove(path);
+		LittleFS.rename(temporaryPath, path);
+	}
+
+	void Log::repair() {
+		// Compaction could be interrupted after removing the log
+		if (!LittleFS.exists(path) && LittleFS.exists(temporaryPath)) {
+			LittleFS.rename(temporaryPath, path);
+		}
+		File file = LittleFS.open(path, "r+");
+		if (!file) {
+			return;
+		}
+		if (const size_t size = file.size(); size % sizeof(Record)) {
+			LOG_INFO(History, "Truncating torn record in '%s'", path);
+			file.truncate(size - size % sizeof(Record));
+		}
+	}
+
+	Log minutes { "/history/minutes", "/history/minutes.tmp", minuteCapacity };
+	Log hours   { "/history/hours",   "/history/hours.tmp",   hourCapacity };
+
+	void setup() {
+		LittleFS.mkdir("/history");
+		minutes.repair();
+		hours.repair();
+	}
+
+	void flush() {
+		minutes.flush();
+		hours.flush();
+	}
+
+	void finishMinute() {
+		const Record record = minute.toRecord();
+		minutes.append(record);
+
+		const uint32_t hourStart = record.time - record.time % 3600;
+		if (hour.count && hour.periodStart != hourStart) {
+			hours.append(hour.toRecord());
+			flush(); // at least once per hour
+			hour.count = 0;
+		}
+		hour.periodStart = hourStart;
+		hour.add(record.min, record.avg, record.max);
+	}
+
+	void record(std::time_t time, float temperature) {
+		const uint32_t slot = time / rawInterval;
+		if (slot == rawNewestSlot) {
+			return;
+		}
+		const int16_t value = static_cast<int16_t>(std::clamp<long>(std::lround(temperature * 100), INT16_MIN + 1, INT16_MAX));
+
+		// Raw samples, marking skipped slots as missing
+		if (rawNewestSlot == 0 || slot < rawNewestSlot || slot - rawNewestSlot >= rawCapacity) {
+			if (slot < rawNewestSlot) {
+				LOG_INFO(History, "Clock went back, dropping recent history");
+				minute.count = hour.count = 0;
+			}
+			std::fill(std::begin(raw), std::end(raw), missing);
+		}
+		else {
+			for (uint32_t s = rawNewestSlot + 1; s < slot; s++) {
+				raw[s % rawCapacity] = missing;
+			}
+		}
+		raw[slot % rawCapacity] = value;
+		rawNewestSlot = slot;
+
+		// Aggregates
+		const uint32_t minuteStart = time - time % 60;
+		if (minute.count && minute.periodStart != minuteStart) {
+			finishMinute();
+			minute.count = 0;
+		}
+		minute.periodStart = minuteStart;
+		minute.add(value, value, value);
+	}
+
+#ifndef NATIVE
+	void handleRequest() {
+		const String& tierArg = webServer.arg("tier");
+		Tier tier;
+		if (tierArg.isEmpty() || tierArg == "minute") {
+			tier = Tier::Minute;
+		}
+		else if (tierArg == "raw") {
+			tier = Tier::Raw;
+		}
+		else if (tierArg == "hour") {
+			tier = Tier::Hour;
+		}
+		else {
+			webServer.send(400, "text/plain", F("Unknown tier"));
+			return;
+		}
+		const bool binary = webServer.arg("format") == "binary";
+		const uint32_t since = strtoul(webServer.arg("since").c_str(), nullptr, 10);
+
+		webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+		webServer.send(200, binary ? "application/octet-stream" : "text/csv", emptyString);
+
+		ResponseWriter writer;
+		if (!binary) {
+			writer.printf("time,min,avg,max\n");
+		}
+		const auto write = [&](const Record& record) {
+			if (record.time < since) {
+				return;
+			}
+			if (binary) {
+				writer.write(&record, sizeof(record));
+			}
+			else {
+				writer.printf("%u,%.2f,%.2f,%.2f\n", record.time, record.min / 100.0, record.avg / 100.0, record.max / 100.0);
+			}
+		};
+
+		switch (tier) {
+			case Tier::Raw: {
+				if (rawNewestSlot == 0) {
+					break;
+				}
+				const uint32_t oldestSlot = rawNewestSlot >= rawCapacity ? rawNewestSlot - rawCapacity + 1 : 0;
+				for (uint32_t slot = oldestSlot; slot <= rawNewestSlot; slot++) {
+					const int16_t value = raw[slot % rawCapacity];
+					if (value == missing) {
+						continue;
+					}
+					Record record { slot * rawInterval, value, value, value, 0 };
+					record.check = record.calculateCheck();
+					write(record);
+				}
+				break;
+			}
+			case Tier::Minute:
+				minutes.forEach(write);
+				break;
+			case Tier::Hour:
+				hours.forEach(write);
+				break;
+		}
+	}
+#endif
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "common.hpp"
+#include <LittleFS.h>
+#include <ctime>
+
+/// \brief Fixed-memory history of (primary) temperature readings, in tiers
+/// of decreasing resolution: raw samples for the last hour (in RAM),
+/// per-minute min/avg/max for the last day and hourly ones for the last
+/// month (both as append-only logs on the file system).
+namespace History {
+	/// Aggregated readings over a period, also the on-disk and binary response format.
+	struct Record {
+		uint32_t time; // start of the period, as Unix timestamp
+		int16_t min; // all temperatures are in centidegrees Celsius
+		int16_t avg;
+		int16_t max;
+		uint16_t check; // detects torn or corrupted writes
+
+		uint16_t calculateCheck() const;
+		inline bool isValid() const {
+			return check == calculateCheck();
+		}
+	};
+	static_assert(sizeof(Record) == 12);
+
+	/// \brief Append-only log of records on the file system. Appends are buffered
+	/// (to spare the flash), the log is compacted by rewriting only the last
+	/// `capacity` records (to temporary file, renamed over the log) once it
+	/// grows twice as long. Torn trailing record is cut off on setup.
+	struct Log {
+		static constexpr uint8_t maxPending = 10;
+
+		const char* path;
+		const char* temporaryPath;
+		uint16_t capacity;
+		Record pending[maxPending];
+		uint8_t pendingCount = 0;
+
+		void append(const Record& record);
+
+		/// Writes pending records, compacting the log if it grew too long.
+		void flush();
+
+		/// Rewrites the log with only the last `capacity` records.
+		void compact();
+
+		/// \brief Finishes compaction interrupted after removing the log,
+		/// and truncates torn trailing record (like from power loss).
+		void repair();
+
+		/// Calls the callback for each valid record (including pending ones).
+		template <typename Callback>
+		void forEach(Callback callback) const {
+			if (File file = LittleFS.open(path, "r")) {
+				Record buffer[16];
+				while (const size_t read = file.read(reinterpret_cast<uint8_t*>(buffer), sizeof(buffer))) {
+					for (size_t i = 0; i < read / sizeof(Record); i++) {
+						if (buffer[i].isValid()) {
+							callback(buffer[i]);
+						}
+					}
+				}
+			}
+			for (uint8_t i = 0; i < pendingCount; i++) {
+				callback(pending[i]);
+			}
+		}
+	};
+
+	enum class Tier : uint8_t {
+		Raw,    // every 10 seconds, for the last hour
+		Minute, // for the last day
+		Hour,   // for the last 30 days
+	};
+
+	constexpr uint32_t rawInterval = 10; // seconds
+	constexpr uint16_t rawCapacity = 60 * 60 / rawInterval;
+	constexpr uint16_t minuteCapacity = 24 * 60;
+	constexpr uint16_t hourCapacity = 30 * 24;
+
+	/// Repairs logs possibly torn by power loss.
+	void setup();
+
+	/// \brief Records the reading, aggregating it to higher tiers as periods pass.
+	/// Readings more often than raw interval are ignored.
+	void record(std::time_t time, float temperature);
+
+	/// Writes buffered records to the file system.
+	void flush();
+
+#ifndef NATIVE
+	/// \brief Handles `/history` request, streaming the tier (`tier=raw|minute|hour`)
+	/// as CSV (`format=csv`, default) or binary records (`format=binary`),
+	/// optionally only since given Unix timestamp (`since=...`).
+	void handleRequest();
+#endif
+}
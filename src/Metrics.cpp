@@ -0,0 +1,236 @@
+#include "Metrics.hpp"
+#include "AssetCache.hpp"
+#include "DisplayRefresh.hpp"
+#include "GlyphAtlas.hpp"
+#include "NTP.hpp"
+#include "Scheduler.hpp"
+#include <iterator> // size
+#ifndef NATIVE
+#include "ResponseWriter.hpp"
+#endif
+
+namespace Metrics {
+
+Histogram loopIteration;
+Histogram handleClient;
+Histogram render[static_cast<uint8_t>(RenderStage::Count)];
+CallbackStats displayRefresh;
+
+void Histogram::observe(uint32_t duration) {
+	uint8_t i = 0;
+	while (i < bucketsCount && duration > bounds[i]) {
+		i++;
+	}
+	counts[i] += 1;
+	count += 1;
+	sum += duration;
+	if (duration > max) {
+		max = duration;
+	}
+}
+
+struct PageStats {
+	uint8_t id;
+	bool used;
+	uint32_t count;
+	uint32_t max;
+	uint64_t sum;
+};
+constexpr uint8_t maxTrackedPages = 8;
+PageStats pagesStats[maxTrackedPages + 1]; // last one for all other pages
+
+void observePage(uint8_t id, uint32_t duration) {
+	PageStats* stats = &pagesStats[maxTrackedPages];
+	for (uint8_t i = 0; i < maxTrackedPages; i++) {
+		if (!pagesStats[i].used) {
+			pagesStats[i].used = true;
+			pagesStats[i].id = id;
+		}
+		if (pagesStats[i].id == id) {
+			stats = &pagesStats[i];
+			break;
+		}
+	}
+	stats->count += 1;
+	stats->sum += duration;
+	if (duration > stats->max) {
+		stats->max = duration;
+	}
+}
+
+#ifndef NATIVE
+
+void writeHeader(ResponseWriter& writer, const char* name, const char* type, const char* help) {
+	writer.printf("# HELP matrix_%s %s\n# TYPE matrix_%s %s\n", name, help, name, type);
+}
+
+/// Writes single metric sample. Labels (if any) should be without braces.
+void writeSample(ResponseWriter& writer, const char* name, const char* labels, uint64_t value) {
+	writer.printf(*labels ? "matrix_%s{%s} %llu\n" : "matrix_%s%s %llu\n",
+		name, labels, static_cast<unsigned long long>(value));
+}
+
+void writeFloatSample(ResponseWriter& writer, const char* name, const char* labels, float value) {
+	writer.printf(*labels ? "matrix_%s{%s} %g\n" : "matrix_%s%s %g\n",
+		name, labels, static_cast<double>(value));
+}
+
+void writeHistogram(ResponseWriter& writer, const char* name, const char* labels, const Histogram& histogram) {
+	const char* separator = *labels ? "," : "";
+	uint32_t cumulative = 0;
+	for (uint8_t i = 0; i < Histogram::bucketsCount; i++) {
+		cumulative += histogram.counts[i];
+		writer.printf("matrix_%s_bucket{%s%sle=\"%u\"} %u\n",
+			name, labels, separator, Histogram::bounds[i], cumulative);
+	}
+	writer.printf("matrix_%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, histogram.count);
+	char sampleName[48];
+	snprintf(sampleName, sizeof(sampleName), "%s_sum", name);
+	writeSample(writer, sampleName, labels, histogram.sum);
+	snprintf(sampleName, sizeof(sampleName), "%s_count", name);
+	writeSample(writer, sampleName, labels, histogram.count);
+}
+
+const char* const renderStageNames[] = { "background", "update", "compose", "present" };
+static_assert(std::size(renderStageNames) == static_cast<size_t>(RenderStage::Count));
+
+void handleRequest() {
+	// Copy at once, as the callback can interrupt at any time
+	noInterrupts();
+	const uint32_t refreshCount = displayRefresh.count;
+	const uint32_t refreshMax = displayRefresh.max;
+	const uint64_t refreshSum = displayRefresh.sum;
+	interrupts();
+
+	webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+	webServer.send(200, "text/plain; version=0.0.4", emptyString);
+	ResponseWriter writer;
+
+	writeHeader(writer, "uptime_seconds", "counter", "Time since boot.");
+	writeSample(writer, "uptime_seconds", "", millis() / 1000);
+
+	writeHeader(writer, "loop_duration_microseconds", "histogram", "Duration of main loop iterations.");
+	writeHistogram(writer, "loop_duration_microseconds", "", loopIteration);
+	writeHeader(writer, "loop_duration_max_microseconds", "gauge", "Longest main loop iteration.");
+	writeSample(writer, "loop_duration_max_microseconds", "", loopIteration.max);
+
+	writeHeader(writer, "web_handle_client_duration_microseconds", "histogram", "Duration of handling web server clients per loop.");
+	writeHistogram(writer, "web_handle_client_duration_microseconds", "", handleClient);
+	writeHeader(writer, "web_handle_client_duration_max_microseconds", "gauge", "Longest handling of web server clients.");
+	writeSample(writer, "web_handle_client_duration_max_microseconds", "", handleClient.max);
+
+	char labels[32];
+	writeHeader(writer, "render_duration_microseconds", "histogram", "Duration of rendering stages per loop.");
+	for (uint8_t i = 0; i < static_cast<uint8_t>(RenderStage::Count); i++) {
+		snprintf(labels, sizeof(labels), "stage=\"%s\"", renderStageNames[i]);
+		writeHistogram(writer, "render_duration_microseconds", labels, render[i]);
+	}
+	writeHeader(writer, "render_duration_max_microseconds", "gauge", "Longest rendering stage.");
+	for (uint8_t i = 0; i < static_cast<uint8_t>(RenderStage::Count); i++) {
+		snprintf(labels, sizeof(labels), "stage=\"%s\"", renderStageNames[i]);
+		writeSample(writer, "render_duration_max_microseconds", labels, render[i].max);
+	}
+
+	// Samples need to be grouped by families, so pages are iterated for each
+	const auto writePagesFamily = [&](const char* name, const char* type, const char* help, auto value) {
+		writeHeader(writer, name, type, help);
+		for (const auto& stats : pagesStats) {
+			if (stats.count == 0) {
+				continue;
+			}
+			if (&stats == &pagesStats[maxTrackedPages]) {
+				snprintf(labels, sizeof(labels), "page=\"other\"");
+			}
+			else {
+				snprintf(labels, sizeof(labels), "page=\"%u\"", stats.id);
+			}
+			writeSample(writer, name, labels, value(stats));
+		}
+	};
+	writePagesFamily("page_render_microseconds_total", "counter", "Time spent rendering the page.",
+		[](const PageStats& stats) { return stats.sum; });
+	writePagesFamily("page_renders_total", "counter", "Number of page updates.",
+		[](const PageStats& stats) { return stats.count; });
+	writePagesFamily("page_render_max_microseconds", "gauge", "Longest page update.",
+		[](const PageStats& stats) { return stats.max; });
+
+	const auto writeTasksFamily = [&](const char* name, const char* type, const char* help, auto value) {
+		writeHeader(writer, name, type, help);
+		for (const auto& task : scheduler) {
+			snprintf(labels, sizeof(labels), "task=\"%s\"", task.name);
+			writeSample(writer, name, labels, value(task.stats));
+		}
+	};
+	using TaskStats = Scheduler::Stats;
+	writeTasksFamily("task_runs_total", "counter", "Number of scheduled task runs.",
+		[](const TaskStats& stats) { return stats.runs; });
+	writeTasksFamily("task_overruns_total", "counter", "Number of scheduled task runs exceeding the time budget.",
+		[](const TaskStats& stats) { return stats.overruns; });
+	writeTasksFamily("task_duration_microseconds_total", "counter", "Time spent in scheduled task.",
+		[](const TaskStats& stats) { return stats.totalDuration; });
+	writeTasksFamily("task_duration_max_microseconds", "gauge", "Longest scheduled task run.",
+		[](const TaskStats& stats) { return stats.maxDuration; });
+	writeTasksFamily("task_lateness_max_milliseconds", "gauge", "Longest delay of scheduled task start after its deadline.",
+		[](const TaskStats& stats) { return stats.maxLateness; });
+
+	writeHeader(writer, "display_refresh_microseconds_total", "counter", "Time spent in display refresh callback.");
+	writeSample(writer, "display_refresh_microseconds_total", "", refreshSum);
+	writeHeader(writer, "display_refresh_calls_total", "counter", "Number of display refresh callback calls.");
+	writeSample(writer, "display_refresh_calls_total", "", refreshCount);
+	writeHeader(writer, "display_refresh_max_microseconds", "gauge", "Longest display refresh callback call.");
+	writeSample(writer, "display_refresh_max_microseconds", "", refreshMax);
+	const auto& refresh = DisplayRefresh::state();
+	writeHeader(writer, "display_refresh_interval_milliseconds", "gauge", "Interval between display refreshes, selected by the governor.");
+	writeSample(writer, "display_refresh_interval_milliseconds", "", refresh.interval);
+	writeHeader(writer, "display_refresh_cpu_share", "gauge", "Share of CPU time taken by display refresh, measured.");
+	writeFloatSample(writer, "display_refresh_cpu_share", "", refresh.measuredCpuShare);
+	writeHeader(writer, "display_refresh_predicted_cpu_share", "gauge", "Share of CPU time taken by display refresh, predicted by the model.");
+	writeFloatSample(writer, "display_refresh_predicted_cpu_share", "", refresh.predictedCpuShare);
+
+	writeHeader(writer, "heap_free_bytes", "gauge", "Free heap.");
+	writeSample(writer, "heap_free_bytes", "", ESP.getFreeHeap());
+	writeHeader(writer, "heap_max_free_block_bytes", "gauge", "Largest block that can be allocated.");
+	writeSample(writer, "heap_max_free_block_bytes", "", ESP.getMaxFreeBlockSize());
+	writeHeader(writer, "heap_fragmentation_percent", "gauge", "Heap fragmentation.");
+	writeSample(writer, "heap_fragmentation_percent", "", ESP.getHeapFragmentation());
+	writeHeader(writer, "stack_free_min_bytes", "gauge", "Stack high-water mark, as lowest free stack since boot.");
+	writeSample(writer, "stack_free_min_bytes", "", ESP.getFreeContStack());
+
+	const auto& cacheStats = assetCache.getStats();
+	writeHeader(writer, "asset_cache_hits_total", "counter", "Asset cache hits.");
+	writeSample(writer, "asset_cache_hits_total", "", cacheStats.hits);
+	writeHeader(writer, "asset_cache_misses_total", "counter", "Asset cache misses.");
+	writeSample(writer, "asset_cache_misses_total", "", cacheStats.misses);
+	writeHeader(writer, "asset_cache_evictions_total", "counter", "Asset cache evictions.");
+	writeSample(writer, "asset_cache_evictions_total", "", cacheStats.evictions);
+	writeHeader(writer, "asset_cache_used_bytes", "gauge", "Memory used by asset cache.");
+	writeSample(writer, "asset_cache_used_bytes", "", assetCache.getUsedBytes());
+
+	const auto& atlasStats = glyphAtlas.getStats();
+	writeHeader(writer, "glyph_atlas_hits_total", "counter", "Glyphs found in the atlas.");
+	writeSample(writer, "glyph_atlas_hits_total", "", atlasStats.hits);
+	writeHeader(writer, "glyph_atlas_misses_total", "counter", "Glyphs rasterized into the atlas.");
+	writeSample(writer, "glyph_atlas_misses_total", "", atlasStats.misses);
+	writeHeader(writer, "glyph_atlas_flushes_total", "counter", "Times the atlas was cleared when full.");
+	writeSample(writer, "glyph_atlas_flushes_total", "", atlasStats.flushes);
+	writeHeader(writer, "glyph_atlas_used_bytes", "gauge", "Memory used by glyph masks.");
+	writeSample(writer, "glyph_atlas_used_bytes", "", glyphAtlas.getUsedBytes());
+
+	const auto& ntpStats = NTP::getStats();
+	writeHeader(writer, "ntp_offset_seconds", "gauge", "Offset of system clock to NTP time, as of last sample.");
+	writeFloatSample(writer, "ntp_offset_seconds", "", ntpStats.offsetMicros / 1e6f);
+	writeHeader(writer, "ntp_residual_seconds", "gauge", "Error of clock model prediction for last sample.");
+	writeFloatSample(writer, "ntp_residual_seconds", "", ntpStats.residualMicros / 1e6f);
+	writeHeader(writer, "ntp_delay_seconds", "gauge", "Round-trip delay of last NTP sample.");
+	writeFloatSample(writer, "ntp_delay_seconds", "", ntpStats.delayMicros / 1e6f);
+	writeHeader(writer, "ntp_drift_ppm", "gauge", "Estimated drift of local clock.");
+	writeFloatSample(writer, "ntp_drift_ppm", "", ntpStats.driftPPM);
+	writeHeader(writer, "ntp_poll_interval_seconds", "gauge", "Current NTP poll interval.");
+	writeSample(writer, "ntp_poll_interval_seconds", "", ntpStats.pollIntervalSeconds);
+	writeHeader(writer, "ntp_clock_steps_total", "counter", "Number of times the clock was stepped instead of slewed.");
+	writeSample(writer, "ntp_clock_steps_total", "", ntpStats.steps);
+}
+
+#endif
+
+}
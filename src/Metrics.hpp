@@ -0,0 +1,91 @@
+#pragma once
+
+#include "common.hpp"
+
+/// \brief Runtime instrumentation (loop, rendering, display refresh, web server
+/// and heap), exposed by `/metrics` endpoint in Prometheus text format.
+/// All durations are in microseconds.
+namespace Metrics {
+
+/// \brief Histogram of durations, with fixed exponential buckets.
+/// Counts are kept per bucket, cumulative ones are calculated when written.
+struct Histogram {
+	static constexpr uint8_t bucketsCount = 12;
+	static constexpr uint32_t bounds[bucketsCount] = {
+		50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+	};
+
+	uint32_t counts[bucketsCount + 1]; // last one for above all bounds
+	uint32_t count;
+	uint64_t sum;
+	uint32_t max;
+
+	void observe(uint32_t duration);
+
+	/// Observes duration from the start, and moves the start to now (for sequential stages).
+	inline void observeSince(uint32_t& start) {
+		const uint32_t now = micros();
+		observe(now - start);
+		start = now;
+	}
+};
+
+/// \brief Time spent in periodic callback (like the display refresh), which
+/// can interrupt the loop, so only plain counters are updated there.
+struct CallbackStats {
+	volatile uint32_t count;
+	volatile uint32_t max;
+	volatile uint64_t sum;
+
+	inline void IRAM_ATTR observe(uint32_t duration) {
+		count = count + 1;
+		sum = sum + duration;
+		if (duration > max) {
+			max = duration;
+		}
+	}
+};
+
+/// Stages of rendering in `pages::updatePagesStuff`.
+enum class RenderStage : uint8_t {
+	Background, // updating background asset & layer
+	Update,     // updating sprites, collecting damaged areas
+	Compose,    // restoring background & drawing sprites off-screen
+	Present,    // pushing finished areas to the display
+	Count
+};
+
+extern Histogram loopIteration;
+extern Histogram handleClient;
+extern Histogram render[static_cast<uint8_t>(RenderStage::Count)];
+extern CallbackStats displayRefresh;
+
+inline Histogram& renderStage(RenderStage stage) {
+	return render[static_cast<uint8_t>(stage)];
+}
+
+/// \brief Records whole render duration for the page, to find pages (or their
+/// animations) taking most of the time. Only first few distinct pages are
+/// tracked separately, the rest is accumulated together.
+void observePage(uint8_t id, uint32_t duration);
+
+/// Measures duration of the scope into the histogram.
+class ScopedTimer {
+	Histogram& histogram;
+	uint32_t start;
+
+public:
+	ScopedTimer(Histogram& histogram)
+		: histogram(histogram), start(micros())
+	{}
+	~ScopedTimer() {
+		histogram.observe(micros() - start);
+	}
+};
+
+#ifndef NATIVE
+/// Handles `/metrics` request, streaming the metrics in Prometheus text format.
+void handleRequest();
+#endif
+
+}
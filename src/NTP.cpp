@@ -1,39 +1,262 @@
 #include "NTP.hpp"
 
 #include <NTPClient.hpp>
+#include <sys/time.h>
+#include <algorithm>
 
 namespace NTP {
 	/// Local UDP socket for NTP client.
 	WiFiUDP ntpUDP;
 
 	/// NTP client to update time. The struct is used to store time even when NTP is not available.
-	NTPClient ntp(ntpUDP, "pl.pool.ntp.org");
+	NTPClient ntp(ntpUDP);
+
+	// TODO: allow changing NTP servers & timezone
+	const char* const servers[] = {
+		"0.pl.pool.ntp.org",
+		"1.pl.pool.ntp.org",
+		"2.pl.pool.ntp.org",
+		"europe.pool.ntp.org",
+	};
+
+	constexpr millis_t minPollInterval = 64 * 1000;
+	constexpr millis_t maxPollInterval = 16384 * 1000; // ~4.5 hours
+	constexpr millis_t retryInterval = 30 * 1000;
+	constexpr millis_t syncTimeout = 2000;
+
+	/// Prediction error small enough to poll less often, in microseconds.
+	constexpr int32_t stableResidual = 10'000;
+	/// Prediction error large enough to poll more often, in microseconds.
+	constexpr int32_t unstableResidual = 50'000;
+	/// Error larger than that is corrected by stepping the clock, instead of slewing.
+	constexpr int64_t stepThreshold = 500'000;
+	/// Maximal correction applied by slewing per discipline tick, in microseconds.
+	constexpr int32_t maxSlewPerTick = 2'000;
+	constexpr millis_t disciplineInterval = 1000;
+	/// Minimal time span of samples history to estimate the drift.
+	constexpr millis_t minDriftSpan = 10 * 60 * 1000;
+	/// Drift estimate larger than that is considered bogus (crystals are way better).
+	constexpr float maxDrift = 500e-6f;
+
+	/// Extends `millis()` to 64 bits, so the model works across its overflow.
+	/// Needs to be called at least once per ~49 days (it is, by the update).
+	uint64_t monotonicMillis() {
+		static uint64_t extended = 0;
+		static millis_t last = 0;
+		const millis_t current = millis();
+		extended += current - last;
+		last = current;
+		return extended;
+	}
+
+	/// Offset of NTP time to local monotonic time, at given local time.
+	struct Point {
+		int64_t localMillis;
+		int64_t offsetMicros; // NTP time minus local monotonic time
+	};
+
+	/// \brief Model of local clock against NTP time, from history of offsets:
+	/// anchor point and drift estimated by linear regression of offsets.
+	struct ClockModel {
+		static constexpr uint8_t historySize = 8;
+		Point history[historySize];
+		uint8_t count = 0;
+		uint8_t next = 0;
+
+		bool valid = false;
+		Point anchor;
+		float drift = 0; // of local clock, as NTP microseconds per local microsecond minus 1
+
+		void reset() {
+			count = next = 0;
+			valid = false;
+			drift = 0;
+		}
+
+		/// Predicts offset at given local time.
+		inline int64_t offsetAt(int64_t localMillis) const {
+			return anchor.offsetMicros + static_cast<int64_t>(drift * (localMillis - anchor.localMillis) * 1000);
+		}
+
+		/// Predicts NTP time (in microseconds since epoch) at given local time.
+		inline int64_t timeAt(int64_t localMillis) const {
+			return localMillis * 1000 + offsetAt(localMillis);
+		}
+
+		void add(const Point& point) {
+			history[next] = point;
+			next = (next + 1) % historySize;
+			if (count < historySize) {
+				count += 1;
+			}
+			fit(point);
+		}
+
+	protected:
+		void fit(const Point& latest) {
+			anchor = latest;
+			valid = true;
+
+			// Least squares fit of offsets, relative to the latest point for precision
+			const Point* oldest = &latest;
+			double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+			for (uint8_t i = 0; i < count; i++) {
+				const Point& point = history[i];
+				if (point.localMillis < oldest->localMillis) {
+					oldest = &point;
+				}
+				const double x = static_cast<double>(point.localMillis - latest.localMillis) * 1000;
+				const double y = static_cast<double>(point.offsetMicros - latest.offsetMicros);
+				sumX += x;
+				sumY += y;
+				sumXX += x * x;
+				sumXY += x * y;
+			}
+			if (count < 2 || latest.localMillis - oldest->localMillis < static_cast<int64_t>(minDriftSpan)) {
+				return; // keep previous estimate
+			}
+			const double denominator = count * sumXX - sumX * sumX;
+			if (denominator <= 0) {
+				return;
+			}
+			const double slope = (count * sumXY - sumX * sumY) / denominator;
+			if (slope > maxDrift || slope < -maxDrift) {
+				LOG_WARN(Time, "Bogus drift estimate: %.1f ppm", slope * 1e6);
+				return;
+			}
+			drift = static_cast<float>(slope);
+
+			// Anchor at fitted line, to smooth out the jitter of single samples
+			const double intercept = (sumY - slope * sumX) / count;
+			anchor.offsetMicros = latest.offsetMicros + static_cast<int64_t>(intercept);
+		}
+	};
+
+	ClockModel model;
+	millis_t pollInterval = minPollInterval;
+	millis_t nextSyncMillis;
+	millis_t lastDisciplineMillis;
+	Stats stats;
+
+	inline int64_t getTimeMicros() {
+		timeval tv;
+		gettimeofday(&tv, nullptr);
+		return static_cast<int64_t>(tv.tv_sec) * 1'000'000 + tv.tv_usec;
+	}
+
+	inline void setTimeMicros(int64_t micros) {
+		timeval tv {
+			.tv_sec = static_cast<time_t>(micros / 1'000'000),
+			.tv_usec = static_cast<suseconds_t>(micros % 1'000'000),
+		};
+		settimeofday(&tv, nullptr);
+	}
 
 	void setup() {
 		LOG_TRACE(Time, "Opening local UDP socket for NTP");
 		ntpUDP.begin(10123);
-		update();
-		// TODO: allow changing NTP server & timezone
+		for (const char* server : servers) {
+			ntp.addServer(server);
+		}
+		ntp.startSync(syncTimeout);
 		setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1); // Hardcoded for Europe/Warsaw
 		tzset();
 	}
 
-	void update() {
-		if (ntp.update(1000)) {
+	void reset() {
+		model.reset();
+		pollInterval = minPollInterval;
+		nextSyncMillis = millis() + minPollInterval;
+	}
+
+	/// Adds the sample to the model, adapting the poll interval to how well it was predicted.
+	void addSample(const NTPClient::Sample& sample) {
+		// Local time of receiving the reply, in extended millis
+		const int64_t localMillis = static_cast<int64_t>(monotonicMillis() - (millis() - sample.receivedMillis));
+		const int64_t ntpMicros = static_cast<int64_t>(sample.seconds) * 1'000'000 + sample.micros();
+		const Point point { localMillis, ntpMicros - localMillis * 1000 };
+
+		stats.delayMicros = sample.delayMicros;
+		stats.offsetMicros = static_cast<int32_t>(std::clamp<int64_t>(
+			ntpMicros - (getTimeMicros() - static_cast<int64_t>(millis() - sample.receivedMillis) * 1000),
+			INT32_MIN, INT32_MAX));
+
+		if (model.valid) {
+			const int64_t residual = point.offsetMicros - model.offsetAt(localMillis);
+			stats.residualMicros = static_cast<int32_t>(std::clamp<int64_t>(residual, INT32_MIN, INT32_MAX));
+			if (residual > stepThreshold || residual < -stepThreshold) {
+				LOG_INFO(Time, "Clock model off by %lld us, starting over", residual);
+				model.reset();
+				pollInterval = minPollInterval;
+			}
+			else if (residual > unstableResidual || residual < -unstableResidual) {
+				pollInterval = std::max(pollInterval / 2, minPollInterval);
+			}
+			else if (residual < stableResidual && residual > -stableResidual && model.count >= 4) {
+				pollInterval = std::min(pollInterval * 2, maxPollInterval);
+			}
+		}
+		model.add(point);
+		stats.driftPPM = model.drift * 1e6f;
+		stats.pollIntervalSeconds = pollInterval / 1000;
+
+		if (CHECK_LOG_LEVEL(Time, LEVEL_DEBUG)) {
 			char timeString[24];
-			std::time_t time = std::time({});
+			const std::time_t time = sample.seconds;
 			std::strftime(timeString, sizeof(timeString), "%FT%TZ", std::gmtime(&time));
-			LOG_DEBUG(Time, "Time updated from NTP: %s (UTC)", timeString);
-			
-			uint32_t remainingMillis = static_cast<uint32_t>(ntp.lastResponseMillis) + ntp.millisSinceUpdate(millis());
-			timeval tv {
-				.tv_sec = ntp.lastResponseSeconds + remainingMillis / 1000,
-				.tv_usec = static_cast<suseconds_t>(remainingMillis % 1000),
-			};
-			settimeofday(&tv, nullptr);
-		}
-		else {
-			LOG_WARN(Time, "Failed to update time from NTP");
+			LOG_DEBUG(Time, "NTP sample: %s (UTC) from %s, delay %u us, offset %d us, drift %.2f ppm, next poll in %u s",
+				timeString, servers[sample.server], sample.delayMicros, stats.offsetMicros, stats.driftPPM, stats.pollIntervalSeconds);
+		}
+	}
+
+	/// Steers system clock towards the model, stepping only on large errors.
+	void discipline() {
+		if (!model.valid) {
+			return;
 		}
+		const int64_t target = model.timeAt(static_cast<int64_t>(monotonicMillis()));
+		const int64_t current = getTimeMicros();
+		const int64_t error = target - current;
+		if (error > stepThreshold || error < -stepThreshold) {
+			LOG_DEBUG(Time, "Stepping the clock by %lld us", error);
+			setTimeMicros(target);
+			stats.steps += 1;
+		}
+		else if (error != 0) {
+			setTimeMicros(current + std::clamp<int64_t>(error, -maxSlewPerTick, maxSlewPerTick));
+		}
+	}
+
+	void update() {
+		const millis_t currentMillis = millis();
+		monotonicMillis(); // keep track of overflows
+
+		switch (ntp.poll()) {
+			case NTPClient::Status::InProgress:
+				break;
+			case NTPClient::Status::Success:
+				addSample(ntp.lastSample());
+				nextSyncMillis = currentMillis + pollInterval;
+				discipline();
+				break;
+			case NTPClient::Status::Failed:
+				LOG_WARN(Time, "Failed to update time from NTP");
+				nextSyncMillis = currentMillis + std::min(retryInterval, pollInterval);
+				break;
+			case NTPClient::Status::Idle:
+				if (static_cast<int32_t>(currentMillis - nextSyncMillis) >= 0) {
+					ntp.startSync(syncTimeout);
+				}
+				break;
+		}
+
+		if (currentMillis - lastDisciplineMillis >= disciplineInterval) {
+			lastDisciplineMillis = currentMillis;
+			discipline();
+		}
+	}
+
+	const Stats& getStats() {
+		return stats;
 	}
 }
@@ -2,6 +2,30 @@
 #include <ctime>
 
 namespace NTP {
+	/// Starts first time synchronization.
 	void setup();
+	/// Progresses time synchronization (or starts next one when due), 
+	/// without blocking, and disciplines the system clock: small errors
+	/// are slewed (few milliseconds per second), only large ones stepped.
+	/// Should be called often, as replies are timestamped when read.
 	void update();
+	/// Forgets the clock model (i.e. after the time was set manually),
+	/// so the clock is left alone until the next synchronization.
+	void reset();
+
+	struct Stats {
+		/// Offset of system clock to NTP time measured by last sample, in microseconds.
+		int32_t offsetMicros;
+		/// Error of the clock model prediction for last sample, in microseconds.
+		int32_t residualMicros;
+		/// Round-trip delay of last sample, in microseconds.
+		uint32_t delayMicros;
+		/// Estimated drift of local clock, in parts per million.
+		float driftPPM;
+		uint32_t pollIntervalSeconds;
+		/// Number of times the clock was stepped, instead of slewed.
+		uint32_t steps;
+	};
+
+	const Stats& getStats();
 }
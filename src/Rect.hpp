@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm> // min, max
+
+/// Axis-aligned rectangle on the display, with exclusive ends.
+struct Rect {
+	int16_t x0;
+	int16_t y0;
+	int16_t x1; // exclusive
+	int16_t y1; // exclusive
+
+	static constexpr Rect fromSize(int16_t x, int16_t y, int16_t width, int16_t height) {
+		return { x, y, static_cast<int16_t>(x + width), static_cast<int16_t>(y + height) };
+	}
+
+	constexpr int16_t width() const { return x1 - x0; }
+	constexpr int16_t height() const { return y1 - y0; }
+	constexpr int32_t area() const { return isEmpty() ? 0 : static_cast<int32_t>(width()) * height(); }
+	constexpr bool isEmpty() const { return x1 <= x0 || y1 <= y0; }
+
+	constexpr bool intersects(const Rect& other) const {
+		return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+	}
+	constexpr bool contains(const Rect& other) const {
+		return x0 <= other.x0 && other.x1 <= x1 && y0 <= other.y0 && other.y1 <= y1;
+	}
+
+	/// Returns common part of both rectangles (might be empty).
+	constexpr Rect intersection(const Rect& other) const {
+		return {
+			std::max(x0, other.x0), std::max(y0, other.y0),
+			std::min(x1, other.x1), std::min(y1, other.y1),
+		};
+	}
+
+	/// Returns smallest rectangle containing both rectangles.
+	constexpr Rect united(const Rect& other) const {
+		if (isEmpty()) return other;
+		if (other.isEmpty()) return *this;
+		return {
+			std::min(x0, other.x0), std::min(y0, other.y0),
+			std::max(x1, other.x1), std::max(y1, other.y1),
+		};
+	}
+
+	constexpr bool operator == (const Rect& other) const {
+		return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+	}
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "common.hpp"
+#include <cstdarg>
+
+/// Buffers the response content, sending it as chunks when full. Response
+/// should be started with unknown content length (chunked encoding).
+class ResponseWriter {
+	char buffer[512];
+	size_t length = 0;
+
+public:
+	~ResponseWriter() {
+		flush();
+	}
+
+	void flush() {
+		if (length) {
+			webServer.sendContent(buffer, length);
+			length = 0;
+		}
+	}
+
+	void write(const void* data, size_t size) {
+		const char* bytes = static_cast<const char*>(data);
+		while (size) {
+			if (length == sizeof(buffer)) {
+				flush();
+			}
+			const size_t part = std::min(size, sizeof(buffer) - length);
+			memcpy(buffer + length, bytes, part);
+			length += part;
+			bytes += part;
+			size -= part;
+		}
+	}
+
+	__attribute__((format(printf, 2, 3)))
+	void printf(const char* format, ...) {
+		for (uint8_t attempt = 0; attempt < 2; attempt++) {
+			va_list args;
+			va_start(args, format);
+			const int ret = vsnprintf(buffer + length, sizeof(buffer) - length, format, args);
+			va_end(args);
+			if (ret < 0) [[unlikely]] {
+				return;
+			}
+			if (length + ret < sizeof(buffer)) {
+				length += ret;
+				return;
+			}
+			flush(); // and try again with empty buffer
+		}
+		LOG_ERROR(Web, "Response line too long");
+	}
+};
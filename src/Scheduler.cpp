@@ -0,0 +1,82 @@
+#include "Scheduler.hpp"
+
+Scheduler::Task* Scheduler::add(const char* name, Callback callback, Type type, Priority priority, millis_t interval, uint32_t budget) {
+	if (count == maxTasks) [[unlikely]] {
+		LOG_ERROR(Scheduler, "Too many tasks, can't add '%s'", name);
+		return nullptr;
+	}
+	Task& task = tasks[count++];
+	task = {
+		.name = name,
+		.callback = callback,
+		.type = type,
+		.priority = priority,
+		.armed = type == Type::Periodic,
+		.interval = interval,
+		.deadline = millis(),
+		.budget = budget,
+		.stats = {},
+	};
+	return &task;
+}
+
+void Scheduler::runIn(Task* task, millis_t delay) {
+	task->deadline = millis() + delay;
+	task->armed = true;
+}
+
+void Scheduler::execute(Task& task, millis_t now) {
+	const uint32_t lateness = now - task.deadline;
+	if (task.type == Type::Deadline) {
+		task.armed = false; // before running, so the task can re-arm itself
+	}
+	else /* periodic */ {
+		task.deadline += task.interval;
+		if (static_cast<int32_t>(now - task.deadline) > 0) {
+			task.deadline = now + task.interval; // skip missed runs, if fell behind
+		}
+	}
+
+	const uint32_t start = micros();
+	task.callback();
+	const uint32_t duration = micros() - start;
+
+	auto& stats = task.stats;
+	stats.runs += 1;
+	stats.totalDuration += duration;
+	if (duration > stats.maxDuration) {
+		stats.maxDuration = duration;
+	}
+	if (lateness > stats.maxLateness) {
+		stats.maxLateness = lateness;
+	}
+	if (duration > task.budget) [[unlikely]] {
+		stats.overruns += 1;
+		LOG_TRACE(Scheduler, "Task '%s' overrun: %u us (budget %u us)", task.name, duration, task.budget);
+	}
+}
+
+void Scheduler::run() {
+	millis_t now = millis();
+
+	Task* lowPriorityTask = nullptr;
+	for (uint8_t i = 0; i < count; i++) {
+		Task& task = tasks[i];
+		if (!task.isDue(now)) {
+			continue;
+		}
+		if (task.priority == Priority::High) {
+			execute(task, now);
+			now = millis();
+		}
+		else if (!lowPriorityTask || static_cast<int32_t>(task.deadline - lowPriorityTask->deadline) < 0) {
+			lowPriorityTask = &task;
+		}
+	}
+
+	if (lowPriorityTask) {
+		execute(*lowPriorityTask, now);
+	}
+}
+
+Scheduler scheduler;
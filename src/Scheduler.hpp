@@ -0,0 +1,87 @@
+#pragma once
+
+#include "common.hpp"
+
+/// \brief Cooperative scheduler of tasks run from the main loop. Tasks are
+/// either periodic (run every interval, or every pass for zero interval)
+/// or deadline ones (run once when the deadline is reached, re-armed by
+/// `runIn`). High priority tasks run whenever due, while at most one low
+/// priority task (the most overdue one) runs per pass, so slow background
+/// work (network, sensors) can't pile up between high priority ones (like
+/// rendering), keeping their cadence. Time spent is accounted per task,
+/// with overruns of the time budget counted for diagnostics.
+class Scheduler {
+public:
+	static constexpr uint8_t maxTasks = 8;
+
+	using Callback = void (*)();
+
+	enum class Type : uint8_t {
+		Periodic,
+		Deadline,
+	};
+
+	enum class Priority : uint8_t {
+		High,
+		Low,
+	};
+
+	struct Stats {
+		uint32_t runs;
+		uint32_t overruns; // number of runs that took longer than the budget
+		uint32_t maxDuration; // in microseconds
+		uint64_t totalDuration; // in microseconds
+		uint32_t maxLateness; // in milliseconds, how late the task started
+	};
+
+	struct Task {
+		const char* name;
+		Callback callback;
+		Type type;
+		Priority priority;
+		bool armed; // false for deadline task waiting to be re-armed
+		millis_t interval;
+		millis_t deadline; // when the task is due next time
+		uint32_t budget; // in microseconds
+		Stats stats;
+
+		inline bool isDue(millis_t now) const {
+			return armed && static_cast<int32_t>(now - deadline) >= 0;
+		}
+	};
+
+protected:
+	Task tasks[maxTasks];
+	uint8_t count = 0;
+
+	Task* add(const char* name, Callback callback, Type type, Priority priority, millis_t interval, uint32_t budget);
+	void execute(Task& task, millis_t now);
+
+public:
+	/// \brief Registers periodic task, first run on the next pass.
+	/// \param interval Interval in milliseconds, or 0 to run on every pass.
+	/// \param budget Expected maximal duration of single run, in microseconds.
+	/// \return Registered task, or null pointer if there are too many tasks.
+	inline Task* addPeriodic(const char* name, Callback callback, millis_t interval, uint32_t budget, Priority priority = Priority::High) {
+		return add(name, callback, Type::Periodic, priority, interval, budget);
+	}
+
+	/// \brief Registers deadline task, not armed until `runIn` is called.
+	/// \param budget Expected maximal duration of single run, in microseconds.
+	/// \return Registered task, or null pointer if there are too many tasks.
+	inline Task* addDeadline(const char* name, Callback callback, uint32_t budget, Priority priority = Priority::Low) {
+		return add(name, callback, Type::Deadline, priority, 0, budget);
+	}
+
+	/// \brief Sets the task to be run after given delay (in milliseconds).
+	/// For periodic tasks, next runs keep the interval from then.
+	void runIn(Task* task, millis_t delay);
+
+	/// Runs all due high priority tasks, and the most overdue low priority one.
+	void run();
+
+	inline const Task* begin() const { return tasks; }
+	inline const Task* end() const { return tasks + count; }
+};
+
+extern Scheduler scheduler;
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include "Rect.hpp"
+
+/// Plain RGB565 pixels buffer, with rows ordered top-to-bottom, without padding.
+struct Surface {
+	uint16_t* pixels;
+	int16_t width;
+	int16_t height;
+
+	inline Rect bounds() const { return Rect::fromSize(0, 0, width, height); }
+	inline uint16_t* row(int16_t y) const { return pixels + y * width; }
+};
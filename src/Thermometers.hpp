@@ -0,0 +1,241 @@
+#pragma once
+
+#include "common.hpp"
+#include <algorithm>
+
+namespace Thermometers {
+
+/// \brief Noise filter for sensor readings: median of few last samples
+/// (rejecting single spikes, i.e. bus glitches), followed by exponential
+/// moving average (smoothing the quantization noise).
+struct Filter {
+	static constexpr uint8_t maxMedianWindow = 5;
+
+	float window[maxMedianWindow];
+	uint8_t medianWindow = 3;
+	uint8_t filled = 0;
+	uint8_t next = 0;
+	/// Weight of new sample in the average, in 1/256 units (256 disables averaging).
+	uint16_t emaAlpha = 64;
+	bool hasValue = false;
+	float value = 0;
+
+	/// \brief Sets the filter parameters, resetting its state.
+	/// \param medianWindow Number of samples to take median of, 1 to disable.
+	/// \param emaAlpha Weight of new sample in the average (1/256 units).
+	void configure(uint8_t medianWindow, uint16_t emaAlpha) {
+		this->medianWindow = std::clamp<uint8_t>(medianWindow, 1, maxMedianWindow);
+		this->emaAlpha = std::clamp<uint16_t>(emaAlpha, 1, 256);
+		reset();
+	}
+
+	void reset() {
+		filled = next = 0;
+		hasValue = false;
+	}
+
+	/// Adds the sample, returning the filtered value.
+	float push(float sample) {
+		window[next] = sample;
+		next = (next + 1) % medianWindow;
+		if (filled < medianWindow) {
+			filled += 1;
+		}
+
+		// Insertion sort of the few samples
+		float sorted[maxMedianWindow];
+		for (uint8_t i = 0; i < filled; i++) {
+			uint8_t j = i;
+			for (; j > 0 && sorted[j - 1] > window[i]; j--) {
+				sorted[j] = sorted[j - 1];
+			}
+			sorted[j] = window[i];
+		}
+		const float median = (filled % 2) ? sorted[filled / 2] : (sorted[filled / 2 - 1] + sorted[filled / 2]) / 2;
+
+		if (hasValue) {
+			value += (median - value) * emaAlpha / 256;
+		}
+		else {
+			value = median;
+			hasValue = true;
+		}
+		return value;
+	}
+};
+
+struct Config {
+	millis_t interval = 1000; // between starts of conversions
+	uint8_t resolution = 12; // bits, 9 to 12
+	uint8_t medianWindow = 3;
+	uint16_t emaAlpha = 64;
+};
+
+/// \brief Non-blocking pipeline reading all DS18B20 sensors on the bus:
+/// sensors are enumerated by addresses, conversion is started on all of
+/// them at once, and results are collected (one sensor per `update` call,
+/// as reading takes few milliseconds) once conversion is complete.
+/// \tparam Driver `DallasTemperature` or compatible stand-in.
+template <typename Driver>
+class Pipeline {
+public:
+	static constexpr uint8_t maxSensors = 4;
+	/// Value returned by the driver for sensor that failed to respond.
+	static constexpr float disconnectedValue = -127.0f;
+	/// Value of the sensor register after power-on, before any conversion.
+	static constexpr float powerOnValue = 85.0f;
+	/// Time between scans of the bus when no sensors are found.
+	static constexpr millis_t rescanInterval = 10'000;
+	/// Number of consecutive failed rounds after which the bus is scanned again.
+	static constexpr uint8_t maxFailedRounds = 3;
+
+	struct Sensor {
+		uint8_t address[8];
+		Filter filter;
+		float last; // last raw reading
+		uint32_t readings;
+		uint32_t errors;
+
+		inline bool hasValue() const {
+			return filter.hasValue;
+		}
+		inline float value() const {
+			return filter.value;
+		}
+	};
+
+protected:
+	enum class State : uint8_t {
+		Scan,
+		Idle,
+		Converting,
+		Reading,
+	};
+
+	Driver& driver;
+	Config config;
+	Sensor sensors[maxSensors];
+	uint8_t count = 0;
+	State state = State::Scan;
+	uint8_t readIndex;
+	uint8_t failedRounds = 0;
+	bool anyReadInRound;
+	millis_t conversionStart;
+	millis_t nextMillis = 0;
+
+	inline millis_t conversionTime() const {
+		return 750 >> (12 - config.resolution);
+	}
+
+	void scan(millis_t now) {
+		driver.begin();
+		driver.setWaitForConversion(false);
+		driver.setResolution(config.resolution);
+
+		count = 0;
+		const uint8_t found = driver.getDeviceCount();
+		for (uint8_t i = 0; i < found && count < maxSensors; i++) {
+			Sensor& sensor = sensors[count];
+			if (!driver.getAddress(sensor.address, i)) {
+				continue;
+			}
+			sensor.filter.configure(config.medianWindow, config.emaAlpha);
+			sensor.readings = sensor.errors = 0;
+			count += 1;
+		}
+		failedRounds = 0;
+
+		if (count == 0) {
+			LOG_ERROR(Temperature, "No sensors found");
+			nextMillis = now + rescanInterval;
+			return;
+		}
+		LOG_DEBUG(Temperature, "Found %u sensor(s)", count);
+		state = State::Idle;
+		nextMillis = now;
+	}
+
+	void read(Sensor& sensor) {
+		const float t = driver.getTempC(sensor.address);
+		sensor.last = t;
+		if (t == disconnectedValue || (t == powerOnValue && sensor.readings == 0)) {
+			sensor.errors += 1;
+			LOG_TRACE(Temperature, "Failed read of sensor %u", static_cast<unsigned>(&sensor - sensors));
+			return;
+		}
+		sensor.readings += 1;
+		sensor.filter.push(t);
+		anyReadInRound = true;
+	}
+
+public:
+	Pipeline(Driver& driver)
+		: driver(driver)
+	{}
+
+	/// Applies the configuration, rescanning the bus.
+	void configure(const Config& config) {
+		this->config = config;
+		this->config.resolution = std::clamp<uint8_t>(config.resolution, 9, 12);
+		state = State::Scan;
+		nextMillis = 0;
+	}
+
+	/// Progresses the pipeline without blocking (only single sensor is read per call).
+	void update(millis_t now) {
+		switch (state) {
+			case State::Scan:
+				if (static_cast<int32_t>(now - nextMillis) >= 0) {
+					scan(now);
+				}
+				break;
+			case State::Idle:
+				if (static_cast<int32_t>(now - nextMillis) >= 0) {
+					driver.requestTemperatures(); // returns right away, as not waiting for conversion
+					conversionStart = now;
+					state = State::Converting;
+				}
+				break;
+			case State::Converting:
+				// Completion is polled from the bus, the timeout covers parasite powered sensors
+				if (driver.isConversionComplete() || now - conversionStart >= conversionTime() + 50) {
+					readIndex = 0;
+					anyReadInRound = false;
+					state = State::Reading;
+				}
+				break;
+			case State::Reading:
+				read(sensors[readIndex++]);
+				if (readIndex < count) {
+					break;
+				}
+				if (anyReadInRound) {
+					failedRounds = 0;
+				}
+				else if (++failedRounds >= maxFailedRounds) {
+					LOG_WARN(Temperature, "No readings for %u rounds, rescanning the bus", failedRounds);
+					state = State::Scan;
+					nextMillis = now;
+					break;
+				}
+				nextMillis = conversionStart + std::max(config.interval, conversionTime());
+				state = State::Idle;
+				break;
+		}
+	}
+
+	/// First sensor with filtered value available, or null pointer.
+	const Sensor* primary() const {
+		for (const Sensor& sensor : *this) {
+			if (sensor.hasValue()) {
+				return &sensor;
+			}
+		}
+		return nullptr;
+	}
+
+	inline const Sensor* begin() const { return sensors; }
+	inline const Sensor* end() const { return sensors + count; }
+};
+
+}
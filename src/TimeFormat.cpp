@@ -0,0 +1,166 @@
+#include "TimeFormat.hpp"
+#include <cstring>
+#include <algorithm>
+
+const char* const TimeFormat::monthNames[12] = {
+	"January", "February", "March", "April", "May", "June", 
+	"July", "August", "September", "October", "November", "December",
+};
+const char* const TimeFormat::weekdayNames[7] = {
+	"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday",
+};
+const char* const TimeFormat::romanNumerals[12] = {
+	"I", "II", "III", "IV", "V", "VI", "VII", "VIII", "IX", "X", "XI", "XII",
+};
+
+void TimeFormat::add(Op op, char character) {
+	if (count == maxTokens) {
+		return; // truncated, as `strftime` would do with too small buffer anyway
+	}
+	tokens[count++] = { op, character };
+	switch (op) {
+		case Op::Second:
+		case Op::Fallback:
+			resolution = Resolution::Second;
+			break;
+		case Op::Minute:
+			resolution = std::min(resolution, Resolution::Minute);
+			break;
+		default:
+			break;
+	}
+}
+
+void TimeFormat::compile(const char* format) {
+	count = 0;
+	resolution = Resolution::Hour;
+	invalidate();
+	for (const char* fp = format; *fp; fp++) {
+		if (*fp != '%') {
+			add(Op::Literal, *fp);
+			continue;
+		}
+		fp++;
+		switch (*fp) {
+			case 0: return;
+			case 'Y': add(Op::Year); break;
+			case 'y': add(Op::Year2); break;
+			case 'm': add(Op::Month); break;
+			case 'B': add(Op::MonthName); break;
+			case 'b':
+			case 'h': add(Op::MonthAbbr); break;
+			case 'o': add(Op::MonthRoman); break;
+			case 'O': add(Op::MonthRomanUpper); break;
+			case 'd': add(Op::Day); break;
+			case 'e': add(Op::DaySpace); break;
+			case 'j': add(Op::YearDay); break;
+			case 'w': add(Op::Weekday); break;
+			case 'u': add(Op::WeekdayIso); break;
+			case 'A': add(Op::WeekdayName); break;
+			case 'a': add(Op::WeekdayAbbr); break;
+			case 'H': add(Op::Hour24); break;
+			case 'I': add(Op::Hour12); break;
+			case 'p': add(Op::AmPm); break;
+			case 'M': add(Op::Minute); break;
+			case 'S': add(Op::Second); break;
+			case 'n': add(Op::Literal, '\n'); break;
+			case 't': add(Op::Literal, '\t'); break;
+			case '%': add(Op::Literal, '%'); break;
+			// Composites are expanded
+			case 'R': 
+				add(Op::Hour24); add(Op::Literal, ':'); add(Op::Minute);
+				break;
+			case 'T': 
+				add(Op::Hour24); add(Op::Literal, ':'); add(Op::Minute); add(Op::Literal, ':'); add(Op::Second);
+				break;
+			case 'D': 
+				add(Op::Month); add(Op::Literal, '/'); add(Op::Day); add(Op::Literal, '/'); add(Op::Year2);
+				break;
+			case 'F': 
+				add(Op::Year); add(Op::Literal, '-'); add(Op::Month); add(Op::Literal, '-'); add(Op::Day);
+				break;
+			default:
+				add(Op::Fallback, *fp);
+				break;
+		}
+	}
+}
+
+size_t TimeFormat::format(char* buffer, size_t size, std::time_t time, const std::tm& tm) {
+	if (size == 0) {
+		return 0;
+	}
+	char* output = buffer;
+	char* const limit = buffer + size - 1; // for null terminator
+	const auto put = [&](char c) {
+		if (output < limit) *output++ = c;
+	};
+	const auto putString = [&](const char* s, uint8_t length = 255) {
+		while (*s && length--) put(*s++);
+	};
+	const auto putNumber = [&](int value, uint8_t digits, char pad = '0') {
+		char temp[8];
+		uint8_t n = 0;
+		do {
+			temp[n++] = '0' + value % 10;
+			value /= 10;
+		}
+		while (value && n < sizeof(temp));
+		while (n < digits) {
+			put(pad);
+			digits--;
+		}
+		while (n) put(temp[--n]);
+	};
+
+	for (uint8_t i = 0; i < count; i++) {
+		const Token& token = tokens[i];
+		switch (token.op) {
+			case Op::Literal:     put(token.character); break;
+			case Op::Year:        putNumber(tm.tm_year + 1900, 4); break;
+			case Op::Year2:       putNumber((tm.tm_year + 1900) % 100, 2); break;
+			case Op::Month:       putNumber(tm.tm_mon + 1, 2); break;
+			case Op::MonthName:   putString(monthNames[tm.tm_mon % 12]); break;
+			case Op::MonthAbbr:   putString(monthNames[tm.tm_mon % 12], 3); break;
+			case Op::MonthRomanUpper: putString(romanNumerals[tm.tm_mon % 12]); break;
+			case Op::MonthRoman:
+				for (const char* s = romanNumerals[tm.tm_mon % 12]; *s; s++) {
+					put(*s + ('a' - 'A'));
+				}
+				break;
+			case Op::Day:         putNumber(tm.tm_mday, 2); break;
+			case Op::DaySpace:    putNumber(tm.tm_mday, 2, ' '); break;
+			case Op::YearDay:     putNumber(tm.tm_yday + 1, 3); break;
+			case Op::Weekday:     putNumber(tm.tm_wday, 1); break;
+			case Op::WeekdayIso:  putNumber(tm.tm_wday ? tm.tm_wday : 7, 1); break;
+			case Op::WeekdayName: putString(weekdayNames[tm.tm_wday % 7]); break;
+			case Op::WeekdayAbbr: putString(weekdayNames[tm.tm_wday % 7], 3); break;
+			case Op::Hour24:      putNumber(tm.tm_hour, 2); break;
+			case Op::Hour12:      putNumber(tm.tm_hour % 12 ? tm.tm_hour % 12 : 12, 2); break;
+			case Op::AmPm:        putString(tm.tm_hour < 12 ? "AM" : "PM"); break;
+			case Op::Minute:      putNumber(tm.tm_min, 2); break;
+			case Op::Second:      putNumber(tm.tm_sec, 2); break;
+			case Op::Fallback: {
+				const char conversion[3] = { '%', token.character, 0 };
+				output += std::strftime(output, limit - output + 1, conversion, &tm);
+				break;
+			}
+		}
+	}
+	*output = 0;
+
+	// Text stays the same until the finest used field changes
+	formattedAt = time;
+	switch (resolution) {
+		case Resolution::Second:
+			validUntil = time + 1;
+			break;
+		case Resolution::Minute:
+			validUntil = time - tm.tm_sec + 60;
+			break;
+		case Resolution::Hour:
+			validUntil = time - tm.tm_sec - tm.tm_min * 60 + 3600;
+			break;
+	}
+	return output - buffer;
+}
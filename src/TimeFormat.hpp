@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+
+/// \brief Time format compiled once from `strftime`-like format string into
+/// small program of tokens, so formatting avoids parsing the format and calling
+/// (surprisingly expensive on ESP8266) newlib `strftime` every frame. Also 
+/// knows the finest field it uses, so text is formatted again only when it
+/// could change (i.e. once a minute for `%H:%M`).
+///
+/// Besides usual conversions (in "C" locale), custom extensions are supported:
+/// `%o` for lower-case and `%O` for upper-case Roman numeral month. Unsupported
+/// conversions are passed to `strftime` one by one.
+class TimeFormat {
+public:
+	static constexpr uint8_t maxTokens = 24;
+
+	/// Finest field used by the format, deciding how long formatted text is valid.
+	enum class Resolution : uint8_t {
+		Second,
+		Minute,
+		Hour, // or coarser, as time zone offset might change on any hour
+	};
+
+	enum class Op : uint8_t {
+		Literal,
+		Year,        // %Y
+		Year2,       // %y
+		Month,       // %m
+		MonthName,   // %B
+		MonthAbbr,   // %b, %h
+		MonthRoman,  // %o (lower-case)
+		MonthRomanUpper, // %O
+		Day,         // %d
+		DaySpace,    // %e
+		YearDay,     // %j
+		Weekday,     // %w (0-6, Sunday first)
+		WeekdayIso,  // %u (1-7, Monday first)
+		WeekdayName, // %A
+		WeekdayAbbr, // %a
+		Hour24,      // %H
+		Hour12,      // %I
+		AmPm,        // %p
+		Minute,      // %M
+		Second,      // %S
+		Fallback,    // other conversion, formatted using `strftime`
+	};
+
+	struct Token {
+		Op op;
+		char character; // for literals, or conversion for fallback
+	};
+
+protected:
+	Token tokens[maxTokens];
+	uint8_t count = 0;
+	Resolution resolution = Resolution::Hour;
+	std::time_t formattedAt = 0;
+	std::time_t validUntil = 0; // exclusive
+
+	void add(Op op, char character = 0);
+
+public:
+	/// Compiles the format string, invalidating any formatted text.
+	void compile(const char* format);
+
+	/// Forgets when the text was formatted, so it's formatted next time.
+	inline void invalidate() { validUntil = 0; }
+
+	/// Checks whenever text formatted for given time could differ from last one.
+	inline bool isDue(std::time_t time) const {
+		return time >= validUntil || time < formattedAt;
+	}
+
+	/// \brief Formats the time (like `strftime`), remembering until when the text stays valid.
+	/// \param time Time to be formatted.
+	/// \param tm Broken-down time (local or UTC) for the time.
+	/// \return Length of the text, without null terminator.
+	size_t format(char* buffer, size_t size, std::time_t time, const std::tm& tm);
+
+	inline Resolution getResolution() const { return resolution; }
+
+	static const char* const monthNames[12];
+	static const char* const weekdayNames[7];
+	static const char* const romanNumerals[12];
+};
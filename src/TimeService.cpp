@@ -0,0 +1,115 @@
+#include "TimeService.hpp"
+#include "TimeFormat.hpp" // names
+
+namespace TimeService {
+	Snapshot snapshot = {
+		.time = -1, // never taken
+	};
+
+	struct Subscription {
+		uint8_t changes;
+		Listener listener;
+	};
+	Subscription subscriptions[maxListeners];
+	uint8_t subscriptionsCount = 0;
+
+	/// \brief Approximate sunrise and sunset per month, in minutes of local 
+	/// standard time (CET), for central Poland. Should be good enough for
+	/// day/night assets until location is configurable.
+	constexpr uint16_t daylight[12][2] = {
+		{ 7 * 60 + 40, 15 * 60 + 50 },
+		{ 7 * 60 +  0, 16 * 60 + 45 },
+		{ 5 * 60 + 55, 17 * 60 + 35 },
+		{ 4 * 60 + 45, 18 * 60 + 25 },
+		{ 3 * 60 + 50, 19 * 60 + 10 },
+		{ 3 * 60 + 15, 20 * 60 +  0 },
+		{ 3 * 60 + 35, 19 * 60 + 50 },
+		{ 4 * 60 + 20, 19 * 60 +  0 },
+		{ 5 * 60 + 10, 17 * 60 + 55 },
+		{ 6 * 60 +  0, 16 * 60 + 50 },
+		{ 6 * 60 + 55, 15 * 60 + 55 },
+		{ 7 * 60 + 35, 15 * 60 + 25 },
+	};
+
+	Season seasonOf(int month) {
+		if (month < 2)  return Season::Winter;
+		if (month < 5)  return Season::Spring;
+		if (month < 8)  return Season::Summer;
+		if (month < 11) return Season::Fall;
+		return Season::Winter;
+	}
+
+	bool isNightAt(const std::tm& tm) {
+		int minutes = tm.tm_hour * 60 + tm.tm_min;
+		if (tm.tm_isdst > 0) {
+			minutes -= 60; // table is in standard time
+		}
+		const auto& [sunrise, sunset] = daylight[tm.tm_mon % 12];
+		return minutes < sunrise || minutes >= sunset;
+	}
+
+	bool update() {
+		const std::time_t time = std::time({});
+		if (time == snapshot.time) {
+			return false;
+		}
+		const bool first = snapshot.time == -1;
+		const std::tm previous = snapshot.local;
+		const Season previousSeason = snapshot.season;
+		const bool wasNight = snapshot.isNight;
+
+		snapshot.time = time;
+		snapshot.secondStart = millis();
+		localtime_r(&time, &snapshot.local);
+		gmtime_r(&time, &snapshot.utc);
+		snapshot.season = seasonOf(snapshot.local.tm_mon);
+		snapshot.isNight = isNightAt(snapshot.local);
+
+		const std::tm& local = snapshot.local;
+		uint8_t changes = Seconds;
+		if (first || local.tm_min  != previous.tm_min)  changes |= Minutes;
+		if (first || local.tm_hour != previous.tm_hour) changes |= Hours;
+		if (first || local.tm_mday != previous.tm_mday) changes |= Days;
+		if (first || local.tm_mon  != previous.tm_mon)  changes |= Months;
+		if (first || snapshot.season != previousSeason) changes |= Seasons;
+		if (first || snapshot.isNight != wasNight)      changes |= DayNight;
+		snapshot.changes = changes;
+
+		for (uint8_t i = 0; i < subscriptionsCount; i++) {
+			if (subscriptions[i].changes & changes) {
+				subscriptions[i].listener(snapshot, changes);
+			}
+		}
+		return true;
+	}
+
+	const Snapshot& now() {
+		return snapshot;
+	}
+
+	bool subscribe(uint8_t changes, Listener listener) {
+		if (subscriptionsCount == maxListeners) {
+			LOG_ERROR(Time, "Too many time listeners");
+			return false;
+		}
+		subscriptions[subscriptionsCount++] = { changes, listener };
+		return true;
+	}
+
+	const char* Snapshot::monthName() const {
+		return TimeFormat::monthNames[local.tm_mon % 12];
+	}
+
+	const char* Snapshot::weekdayName() const {
+		return TimeFormat::weekdayNames[local.tm_wday % 7];
+	}
+
+	const char* Snapshot::seasonName() const {
+		switch (season) {
+			case Season::Spring: return "spring";
+			case Season::Summer: return "summer";
+			case Season::Fall:   return "fall";
+			default:             return "winter";
+		}
+	}
+}
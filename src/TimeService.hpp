@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.hpp"
+#include <ctime>
+
+/// \brief Shared snapshot of current time, broken down (local and UTC) once
+/// per second, so time consumers (rendering, history, web server) don't call
+/// libc time functions on their own many times per second. Derived values
+/// (month, season, weekday, day/night) are published along, and subscribed
+/// listeners are notified when they change.
+namespace TimeService {
+	enum class Season : uint8_t {
+		Winter,
+		Spring,
+		Summer,
+		Fall,
+	};
+
+	/// Flags of what changed since previous snapshot.
+	enum Change : uint8_t {
+		Seconds  = 1 << 0,
+		Minutes  = 1 << 1,
+		Hours    = 1 << 2,
+		Days     = 1 << 3, // also weekday
+		Months   = 1 << 4,
+		Seasons  = 1 << 5,
+		DayNight = 1 << 6,
+	};
+
+	struct Snapshot {
+		std::time_t time;
+		std::tm local;
+		std::tm utc;
+		millis_t secondStart; // when the second started (as noticed), i.e. for blinking
+		Season season;
+		bool isNight; // between (approximate) sunset and sunrise
+		uint8_t changes; // flags of what changed on last update
+
+		/// English full name of the month, as for `%B`.
+		const char* monthName() const;
+		/// English full name of the weekday, as for `%A`.
+		const char* weekdayName() const;
+		/// Lower-case name of the season, as used in file names.
+		const char* seasonName() const;
+
+		/// Checks whenever the clock was ever set (synchronized or manually).
+		inline bool isSynchronized() const { return time >= 1'600'000'000; }
+	};
+
+	using Listener = void (*)(const Snapshot& snapshot, uint8_t changes);
+
+	constexpr uint8_t maxListeners = 4;
+
+	/// \brief Takes new snapshot if the second changed (cheap otherwise),
+	/// notifying listeners interested in the changes.
+	/// \return true if new snapshot was taken
+	bool update();
+
+	/// Returns current snapshot, as of last update.
+	const Snapshot& now();
+
+	/// \brief Registers listener called on updates with any of given changes.
+	/// \return true on success, false if there are too many listeners
+	bool subscribe(uint8_t changes, Listener listener);
+}
@@ -1,10 +1,7 @@
 #include "bitmap.hpp"
-#define PxMATRIX_double_buffer false
-#include <PxMatrix.h>
-#include <LittleFS.h>
+#include "colors.hpp"
 #include <algorithm> // min, max
-
-extern PxMATRIX display; // from main for drawToDisplay
+#include <iterator> // size
 
 namespace BMP {
 
@@ -46,12 +43,18 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 			return error = true;
 		}
 
-		// Get and validate DIB header
+		// Get and validate DIB header (only fields we use, as files with alpha 
+		// often come with newer headers, up to BITMAPV5HEADER)
 		BITMAPV2INFOHEADER dibHeader;
 		auto& headerSize = dibHeader.headerSize;
-		headerSize = *reinterpret_cast<const uint32_t*>(headersBuffer);
-		std::memcpy(&dibHeader, headersBuffer + sizeof(BITMAPFILEHEADER), static_cast<size_t>(headerSize));
-		if (dibHeader.headerSize != 40) [[unlikely]] {
+		std::memcpy(&headerSize, headersBuffer + sizeof(BITMAPFILEHEADER), sizeof(headerSize)); // unaligned
+		if (headerSize < 40 || headerSize > 124 || inputBufferLength < sizeof(BITMAPFILEHEADER) + headerSize) [[unlikely]] {
+			LOG_DEBUG(BMP, "Unsupported header");
+			return error = true;
+		}
+		// Masks follow the basic header (as if it was V2) with bit fields compression
+		std::memcpy(&dibHeader, headersBuffer + sizeof(BITMAPFILEHEADER), sizeof(dibHeader));
+		if (dibHeader.headerSize != 40 && dibHeader.bitPerPixel != 32) [[unlikely]] {
 			LOG_DEBUG(BMP, "Unsupported header");
 			return error = true;
 		}
@@ -64,16 +67,39 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 			return error = true;
 		}
 
-		sourceBitsPerPixel = dibHeader.bitPerPixel;
+		sourceBytesPerPixel = dibHeader.bitPerPixel / 8;
+		outputBytesPerPixel = 2;
+		passThrough = false;
 		switch (dibHeader.bitPerPixel) {
 			case 16: // target format, so just validate and pass to output
+				passThrough = true;
 				break;
-			case 24: // handled by converting to 16 bits
+			case 24:
+				if (dibHeader.compression == 3) {
+					// RGB565A8 (target format), so just validate and pass to output
+					passThrough = true;
+					outputBytesPerPixel = 3;
+					break;
+				}
+				// handled by converting to 16 bits
 				if (dibHeader.compression != 0) {
 					LOG_DEBUG(BMP, "Compression is not supported");
 					return error = true;
 				}
 				break;
+			case 32: // handled by converting to 16 bits with 8 bits alpha
+				if (dibHeader.compression == 3 && (dibHeader.redMask != 0x00FF0000 || 
+					dibHeader.greenMask != 0x0000FF00 || dibHeader.blueMask != 0x000000FF)
+				) {
+					LOG_DEBUG(BMP, "Only BGRA channels order is supported");
+					return error = true;
+				}
+				if (dibHeader.compression != 0 && dibHeader.compression != 3) {
+					LOG_DEBUG(BMP, "Compression is not supported");
+					return error = true;
+				}
+				outputBytesPerPixel = 3;
+				break;
 			default:
 				LOG_DEBUG(BMP, "24 bits per pixel expected");
 				return error = true;
@@ -87,16 +113,16 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 		// dibHeader.headerSize = 52; // BITMAPV2INFOHEADER
 
 		// Prepare BMP header for the output
-		dibHeader.imageSize = (dibHeader.width * dibHeader.height) * 2; // 16 bits
+		dibHeader.imageSize = (dibHeader.width * dibHeader.height) * outputBytesPerPixel;
 		fileHeader.offsetToPixelArray = sizeof(fileHeader) + sizeof(dibHeader);
 		fileHeader.size = fileHeader.offsetToPixelArray + dibHeader.imageSize; // TODO: should it include padding?
-		dibHeader.bitPerPixel = 16;
+		dibHeader.bitPerPixel = outputBytesPerPixel * 8;
 		dibHeader.compression = 3; // signal RGB masks should be used (BI_BITFIELDS)
 		dibHeader.redMask = 0xF800;
 		dibHeader.greenMask = 0x07E0;
 		dibHeader.blueMask = 0x001F;
 
-		if (sourceBitsPerPixel == 16) {
+		if (passThrough) {
 			// Validate headers
 			if (std::memcmp(&fileHeader, headersBuffer, sizeof(fileHeader)) != 0 ||
 				std::memcmp(&dibHeader, headersBuffer + sizeof(fileHeader), sizeof(dibHeader)) != 0
@@ -115,13 +141,14 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 		height = static_cast<axis_index_t>(dibHeader.height);
 
 		// Calculate padding (rows need to be aligned to 4 bytes)
-		inputRowPadding = paddingToCeil4(width * 3 /* 24 bits */);
-		outputRowPadding = paddingToCeil4(width * 2 /* 16 bits */);
+		inputRowPadding = paddingToCeil4(width * sourceBytesPerPixel);
+		outputRowPadding = paddingToCeil4(width * outputBytesPerPixel);
 	}
 
-	if (sourceBitsPerPixel == 16) {
+	if (passThrough) {
 		// Pass input to output directly
-		output.write(inputBuffer, sizeof(inputBufferLength));
+		output.write(inputPosition, inputEnd - inputPosition);
+		y = height; // size not tracked
 		return error; // no converting
 	}
 
@@ -133,8 +160,10 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 				if (inputPosition >= inputEnd) [[unlikely]] {
 					return error; // wait for next chunk
 				}
+				inputPosition++;
 				leftoverLength++;
 			}
+			leftoverType = None;
 
 			// Move to next row (as current finished), if any
 			y++;
@@ -144,21 +173,21 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 		}
 
 		for (/* pixels in rows */; x < width; x++) {
-			rgb888be_t rgb888be;
+			bgra8888_t bgra; // alpha only for 32 bits input
 			
 			if (leftoverType == Pixel) [[unlikely]] {
 				// Collect remaining bytes for the pixel
-				while (leftoverLength < sizeof(rgb888be_t)) {
+				while (leftoverLength < sourceBytesPerPixel) {
 					if (inputPosition >= inputEnd) [[unlikely]] {
 						return error; // wait for next chunk
 					}
 					leftoverData.bytes[leftoverLength++] = *inputPosition++;
 				}
-				rgb888be = leftoverData.pixel;
+				bgra = leftoverData.pixel;
 				leftoverType = None;
 			}
 			else /* get pixel from input */ {
-				if (inputPosition + sizeof(rgb888be_t) > inputEnd) [[unlikely]] {
+				if (inputPosition + sourceBytesPerPixel > inputEnd) [[unlikely]] {
 					// Save the leftover
 					leftoverType = Pixel;
 					leftoverLength = 0;
@@ -168,24 +197,30 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 
 					return error; // wait for next chunk
 				}
-				rgb888be = *reinterpret_cast<const rgb888be_t*>(inputPosition);
-				inputPosition += sizeof(rgb888be_t);
+				std::memcpy(&bgra, inputPosition, sourceBytesPerPixel);
+				inputPosition += sourceBytesPerPixel;
 			}
 
-			// Convert RGB888 to RGB565
-			uint16_t rgb565 = (
-				(static_cast<uint16_t>(rgb888be.r >> 3) << 11) | 
-				(static_cast<uint16_t>(rgb888be.g >> 2) << 5) | 
-				(static_cast<uint16_t>(rgb888be.b >> 3))
+			// Convert RGB888 to RGB565 (followed by alpha, if any)
+			const uint16_t rgb565 = (
+				(static_cast<uint16_t>(bgra.r >> 3) << 11) | 
+				(static_cast<uint16_t>(bgra.g >> 2) << 5) | 
+				(static_cast<uint16_t>(bgra.b >> 3))
 			);
+			const uint8_t converted[3] = { 
+				static_cast<uint8_t>(rgb565), static_cast<uint8_t>(rgb565 >> 8), bgra.a 
+			};
 
 			// Write converted pixel to output
-			output.write(reinterpret_cast<char*>(&rgb565), sizeof(rgb565));
+			output.write(converted, outputBytesPerPixel);
 		}
 
+		x = 0; // next row starts from the beginning
+
 		// Add row padding to output
 		if (outputRowPadding) {
-			output.write("AAAA", outputRowPadding);
+			constexpr uint8_t zeros[4] = {};
+			output.write(zeros, outputRowPadding);
 		}
 
 		// Skip row padding of input
@@ -207,7 +242,7 @@ bool RGB565Converter::chunk(const uint8_t* inputBuffer, size_t inputBufferLength
 bool RGB565Converter::finish() {
 	if (error) return error;
 
-	if (x != width || y != height || leftoverType == Pixel) [[unlikely]] {
+	if (y != height || leftoverType == Pixel) [[unlikely]] {
 		LOG_DEBUG(BMP, "Unexpected end");
 		// TODO: fill remaining pixels with zero to allow soft-error?
 		return error = true;
@@ -216,16 +251,7 @@ bool RGB565Converter::finish() {
 	return error;
 }
 
-bool drawToDisplay(Stream& file, uint8_t targetX, uint8_t targetY, uint16_t transparentColor) {
-	// TODO: instead dynamic allocation, consider pre-allocating
-	// TODO: consider caching image data instead reading the file again and again? 
-	//	(layer above, maybe hashing file path; maybe some cache management system?)
-
-	// Read and validate headers
-	struct {
-		BITMAPFILEHEADER fileHeader;
-		BITMAPV2INFOHEADER dibHeader;
-	} headers;
+bool readHeaders(Stream& file, Headers& headers) {
 	int ret = file.read(reinterpret_cast<uint8_t*>(&headers), sizeof(headers));
 	if (ret != sizeof(headers)) [[unlikely]] {
 		LOG_DEBUG(BMP, "Header too short");
@@ -247,39 +273,227 @@ bool drawToDisplay(Stream& file, uint8_t targetX, uint8_t targetY, uint16_t tran
 		LOG_DEBUG(BMP, "Top-to-bottom rows order not supported");
 		return false;
 	}
-	if (headers.dibHeader.bitPerPixel != 16) [[unlikely]] {
+	if (headers.dibHeader.bitPerPixel != 16 && 
+		!(headers.dibHeader.bitPerPixel == 24 && headers.dibHeader.compression == 3)
+	) [[unlikely]] {
 		LOG_DEBUG(BMP, "16 bits per pixel expected");
 		return false;
 	}
+	return true;
+}
 
-	// Draw pixels (bottom-to-top per BMP standard)
-	const auto& width = headers.dibHeader.width;
-	const auto& height = headers.dibHeader.height;
-	const size_t rowLengthInBytes = width * sizeof(uint16_t) + paddingToCeil4(width);
-	uint16_t* rowBuffer = new uint16_t[width + 2 /* account for up to 4 bytes padding */];
-	const auto xLimit = std::min<uint8_t>(targetX + width, display.width());
-	const auto yLimit = std::min<uint8_t>(targetY + height, display.height());
-	LOG_TRACE(BMP, "width=%u height=%u rowLengthInBytes=%u targetX=%u targetY=%u xLimit=%u yLimit=%u rowBuffer=%p", 
-		width, height, rowLengthInBytes, targetX, targetY, xLimit, yLimit, rowBuffer);
-	for (uint8_t y = height; y > yLimit; y--) {
-		// Skip rows that are always outside the display
-		file.read(reinterpret_cast<uint8_t*>(rowBuffer), rowLengthInBytes);
-	}
-	display.startWrite();
-	for (int16_t y = yLimit; y > targetY; y--) { // needs to be signed in case targetY = 0
-		file.read(reinterpret_cast<uint8_t*>(rowBuffer), rowLengthInBytes);
-		for (uint8_t x = 0; x < xLimit; x++) {
-			uint16_t color = *(rowBuffer + x);
-			if (transparentColor && transparentColor == color) [[unlikely]] {
-				continue;
+namespace {
+	/// Reads row of RGB565A8 pixels, splitting them into colors and alpha.
+	bool readRow(Stream& file, uint16_t* pixels, uint8_t* alpha, axis_index_t length) {
+		uint8_t chunk[32 * 3];
+		for (axis_index_t x = 0; x < length; ) {
+			const axis_index_t count = std::min<axis_index_t>(length - x, sizeof(chunk) / 3);
+			if (file.read(chunk, count * 3) != count * 3) [[unlikely]] {
+				return false;
+			}
+			for (const uint8_t* input = chunk; input < chunk + count * 3; input += 3, x++) {
+				pixels[x] = input[0] | (input[1] << 8);
+				alpha[x] = input[2];
 			}
-			display.writePixel(targetX + x, y, color);
 		}
+		return true;
 	}
-	display.endWrite();
-	free(rowBuffer);
+}
+
+bool readPixels(Stream& file, const Headers& headers, uint16_t* output, uint8_t* alpha) {
+	const auto width = headers.width();
+	const auto height = headers.height();
+	const size_t rowLengthInBytes = width * headers.bytesPerPixel();
+	const uint8_t rowPadding = paddingToCeil4(rowLengthInBytes);
+	if (headers.hasAlpha() && !alpha) [[unlikely]] {
+		return false;
+	}
+
+	// Rows are stored bottom-to-top per BMP standard
+	for (axis_index_t y = height - 1; y >= 0; y--) {
+		const bool success = headers.hasAlpha()
+			? readRow(file, output + y * width, alpha + y * width, width)
+			: file.read(reinterpret_cast<uint8_t*>(output + y * width), rowLengthInBytes) == static_cast<int>(rowLengthInBytes);
+		if (!success) [[unlikely]] {
+			LOG_DEBUG(BMP, "Data exhausted before expected end");
+			return false;
+		}
+		if (rowPadding) {
+			uint8_t padding[4];
+			file.read(padding, rowPadding);
+		}
+	}
+	return true;
+}
+
+uint16_t rowBuffer[MATRIX_WIDTH];
 
+bool draw(const Surface& target, File& file, const Headers& headers, int16_t targetX, int16_t targetY, uint16_t transparentColor, const Rect& clip) {
+	const auto width = headers.width();
+	const auto height = headers.height();
+	const Rect area = Rect::fromSize(targetX, targetY, width, height)
+		.intersection(clip)
+		.intersection(target.bounds());
+	if (area.isEmpty()) {
+		return true;
+	}
+	if (area.width() > static_cast<axis_index_t>(std::size(rowBuffer))) [[unlikely]] {
+		LOG_ERROR(BMP, "Target too wide for row buffer");
+		return false;
+	}
+
+	const uint8_t bytesPerPixel = headers.bytesPerPixel();
+	const size_t rowLengthInBytes = width * bytesPerPixel + paddingToCeil4(width * bytesPerPixel);
+	const size_t pixelsOffset = file.position() + (area.x0 - targetX) * bytesPerPixel;
+	const size_t lengthInBytes = area.width() * sizeof(uint16_t);
+	uint8_t alpha[MATRIX_WIDTH];
+	LOG_TRACE(BMP, "width=%u height=%u targetX=%d targetY=%d area=%d,%d-%d,%d", 
+		width, height, targetX, targetY, area.x0, area.y0, area.x1, area.y1);
+
+	// Rows are stored bottom-to-top per BMP standard, so going up keeps seeking forward
+	for (axis_index_t y = area.y1 - 1; y >= area.y0; y--) {
+		const size_t storedRowIndex = targetY + height - 1 - y;
+		if (!file.seek(pixelsOffset + storedRowIndex * rowLengthInBytes, SeekSet)) [[unlikely]] {
+			LOG_DEBUG(BMP, "Data exhausted before expected end");
+			return false;
+		}
+		if (headers.hasAlpha()) {
+			if (!readRow(file, rowBuffer, alpha, area.width())) [[unlikely]] {
+				LOG_DEBUG(BMP, "Data exhausted before expected end");
+				return false;
+			}
+			blendRow(target.row(y) + area.x0, rowBuffer, alpha, area.width());
+			continue;
+		}
+		if (file.read(reinterpret_cast<uint8_t*>(rowBuffer), lengthInBytes) != static_cast<int>(lengthInBytes)) [[unlikely]] {
+			LOG_DEBUG(BMP, "Data exhausted before expected end");
+			return false;
+		}
+		blitRow(target.row(y) + area.x0, rowBuffer, area.width(), transparentColor);
+	}
 	return true;
 }
 
+void blitRow(uint16_t* output, const uint16_t* input, axis_index_t length, uint16_t transparentColor) {
+	if (!transparentColor) {
+		std::memcpy(output, input, length * sizeof(uint16_t));
+		return;
+	}
+	axis_index_t x = 0;
+	while (x < length) {
+		while (x < length && input[x] == transparentColor) x++;
+		const axis_index_t start = x;
+		while (x < length && input[x] != transparentColor) x++;
+		if (x > start) {
+			std::memcpy(output + start, input + start, (x - start) * sizeof(uint16_t));
+		}
+	}
+}
+
+void blendRow(uint16_t* output, const uint16_t* input, const uint8_t* alpha, axis_index_t length) {
+	axis_index_t x = 0;
+	while (x < length) {
+		while (x < length && alpha[x] == 0) x++;
+		const axis_index_t start = x;
+		while (x < length && alpha[x] == 255) x++;
+		if (x > start) {
+			std::memcpy(output + start, input + start, (x - start) * sizeof(uint16_t));
+		}
+		for (; x < length && alpha[x] != 0 && alpha[x] != 255; x++) {
+			output[x] = colors::blend565(input[x], output[x], alpha[x]);
+		}
+	}
+}
+
+uint16_t* computeOpaqueSpans(const uint16_t* pixels, axis_index_t width, axis_index_t height, uint16_t transparentColor, size_t& sizeInBytes) {
+	// Count spans first, to allocate exactly
+	size_t count = 0;
+	for (axis_index_t y = 0; y < height; y++) {
+		const uint16_t* row = pixels + y * width;
+		for (axis_index_t x = 0; x < width; x++) {
+			if (row[x] != transparentColor && (x == 0 || row[x - 1] == transparentColor)) {
+				count++;
+			}
+		}
+	}
+	const size_t length = height + 1 + count * 2;
+	if (length > UINT16_MAX) [[unlikely]] {
+		return nullptr;
+	}
+	uint16_t* spans = new (std::nothrow) uint16_t[length];
+	if (!spans) [[unlikely]] {
+		return nullptr;
+	}
+
+	uint16_t offset = height + 1;
+	for (axis_index_t y = 0; y < height; y++) {
+		const uint16_t* row = pixels + y * width;
+		spans[y] = offset;
+		axis_index_t x = 0;
+		while (x < width) {
+			while (x < width && row[x] == transparentColor) x++;
+			const axis_index_t start = x;
+			while (x < width && row[x] != transparentColor) x++;
+			if (x > start) {
+				spans[offset++] = start;
+				spans[offset++] = x;
+			}
+		}
+	}
+	spans[height] = offset;
+	sizeInBytes = length * sizeof(uint16_t);
+	return spans;
+}
+
+void draw(const Surface& target, const uint16_t* pixels, axis_index_t width, axis_index_t height, int16_t targetX, int16_t targetY, uint16_t transparentColor, const Rect& clip) {
+	const Rect area = Rect::fromSize(targetX, targetY, width, height)
+		.intersection(clip)
+		.intersection(target.bounds());
+	if (area.isEmpty()) {
+		return;
+	}
+	for (axis_index_t y = area.y0; y < area.y1; y++) {
+		const uint16_t* input = pixels + (y - targetY) * width - targetX;
+		uint16_t* output = target.row(y);
+		blitRow(output + area.x0, input + area.x0, area.width(), transparentColor);
+	}
+}
+
+void draw(const Surface& target, const uint16_t* pixels, const uint16_t* spans, axis_index_t width, axis_index_t height, int16_t targetX, int16_t targetY, const Rect& clip) {
+	const Rect area = Rect::fromSize(targetX, targetY, width, height)
+		.intersection(clip)
+		.intersection(target.bounds());
+	if (area.isEmpty()) {
+		return;
+	}
+	// Clip columns in source coordinates
+	const axis_index_t x0 = area.x0 - targetX;
+	const axis_index_t x1 = area.x1 - targetX;
+	for (axis_index_t y = area.y0; y < area.y1; y++) {
+		const axis_index_t sourceY = y - targetY;
+		const uint16_t* input = pixels + sourceY * width;
+		uint16_t* output = target.row(y) + targetX;
+		for (uint16_t i = spans[sourceY]; i < spans[sourceY + 1]; i += 2) {
+			const axis_index_t start = std::max<axis_index_t>(spans[i], x0);
+			const axis_index_t end = std::min<axis_index_t>(spans[i + 1], x1);
+			if (start < end) {
+				std::memcpy(output + start, input + start, (end - start) * sizeof(uint16_t));
+			}
+		}
+	}
+}
+
+void draw(const Surface& target, const uint16_t* pixels, const uint8_t* alpha, axis_index_t width, axis_index_t height, int16_t targetX, int16_t targetY, const Rect& clip) {
+	const Rect area = Rect::fromSize(targetX, targetY, width, height)
+		.intersection(clip)
+		.intersection(target.bounds());
+	if (area.isEmpty()) {
+		return;
+	}
+	for (axis_index_t y = area.y0; y < area.y1; y++) {
+		const size_t offset = (y - targetY) * width + (area.x0 - targetX);
+		blendRow(target.row(y) + area.x0, pixels + offset, alpha + offset, area.width());
+	}
+}
+
 }
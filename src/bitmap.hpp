@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.hpp"
+#include <FS.h> // File
+#include "Surface.hpp"
 
 namespace BMP {
 
@@ -44,10 +46,25 @@ struct rgb888be_t {
 	uint8_t r;
 };
 
+struct bgra8888_t {
+	uint8_t b;
+	uint8_t g;
+	uint8_t r;
+	uint8_t a;
+};
+
 using axis_index_t = int16_t;
 
+/// \brief Preallocated row buffer, used when streaming pixels from files,
+/// as rows are clipped to the target (which is never wider than the display).
+extern uint16_t rowBuffer[MATRIX_WIDTH];
+
 /// \brief Coordinates chunked conversion of 24 bit (RGB888) BMP file 
 /// to 16 bit (RGB565) format. 
+///
+/// 32 bit (RGBA8888) files are converted to RGB565 with 8 bit alpha (RGB565A8)
+/// instead: 24 bits per pixel, each being RGB565 followed by alpha byte, with
+/// RGB565 masks (and `BI_BITFIELDS` compression) marking the format. 
 class RGB565Converter
 {
 	axis_index_t width;
@@ -60,13 +77,15 @@ class RGB565Converter
 	enum LeftoverType { None, Pixel, Padding };
 
 	union {
-		uint8_t bytes[sizeof(rgb888be_t)]; // used to (partially) fill pixel data
-		rgb888be_t pixel;
+		uint8_t bytes[sizeof(bgra8888_t)]; // used to (partially) fill pixel data
+		bgra8888_t pixel;
 	} leftoverData;
 	uint8_t leftoverLength;
 	LeftoverType leftoverType;
 
-	uint8_t sourceBitsPerPixel;
+	uint8_t sourceBytesPerPixel;
+	uint8_t outputBytesPerPixel;
+	bool passThrough; // input already in target format
 
 	bool error;
 
@@ -87,12 +106,92 @@ public:
 	bool finish();
 };
 
-/// \brief Draws BMP stream to the display.
-/// @param file Handle for the open BMP stream (or file).
-/// @param x horizontal axis target (display) position offset
-/// @param y vertical axis target (display) position offset
+/// Headers of BMP file, as stored by our converters (16 bits per pixel,
+/// or 24 bits per pixel for RGB565 with alpha).
+struct Headers {
+	BITMAPFILEHEADER fileHeader;
+	BITMAPV2INFOHEADER dibHeader;
+
+	inline axis_index_t width() const { return static_cast<axis_index_t>(dibHeader.width); }
+	inline axis_index_t height() const { return static_cast<axis_index_t>(dibHeader.height); }
+	inline bool hasAlpha() const { return dibHeader.bitPerPixel == 24; }
+	inline uint8_t bytesPerPixel() const { return hasAlpha() ? 3 : 2; }
+};
+
+/// \brief Reads and validates BMP headers from the stream.
+/// @param file Handle for the open BMP stream (or file), positioned at start.
+/// @param headers Output headers
+/// @return true on success (16 bits per pixel BMP, or RGB565A8), false otherwise
+bool readHeaders(Stream& file, Headers& headers);
+
+/// \brief Reads pixels of the BMP stream into continuous RGB565 block, 
+/// with rows ordered top-to-bottom and without padding.
+/// @param file Handle for the open BMP stream, positioned right after headers.
+/// @param headers Headers read from the stream before.
+/// @param output Buffer for at least `width * height` pixels.
+/// @param alpha Buffer for `width * height` alpha values, laid out as pixels;
+/// required only if headers indicate alpha.
+/// @return true on success, false otherwise
+bool readPixels(Stream& file, const Headers& headers, uint16_t* output, uint8_t* alpha = nullptr);
+
+/// \brief Draws BMP file to the surface, with headers already read. Only 
+/// rows and columns within the target are read, seeking past others.
+/// Files with alpha are blended over the target (ignoring transparent color).
+/// @param target Surface to draw on.
+/// @param file Handle for the open BMP file, positioned right after headers.
+/// @param headers Headers read from the file before.
+/// @param x horizontal axis target position offset
+/// @param y vertical axis target position offset
 /// @param transparentColor transparent color (RGB565), or 0 for no transparency
+/// @param clip Area of the target to limit drawing to.
 /// @return true on success, false otherwise
-bool drawToDisplay(Stream& file, uint8_t targetX, uint8_t targetY, uint16_t transparentColor = 0);
+bool draw(const Surface& target, File& file, const Headers& headers, int16_t targetX, int16_t targetY, uint16_t transparentColor, const Rect& clip);
+
+/// \brief Copies row of pixels as spans, skipping runs of transparent color.
+/// @param output Target row, at the first pixel to be written.
+/// @param input Source row, at the first pixel to be copied.
+/// @param length Number of pixels.
+/// @param transparentColor transparent color (RGB565), or 0 for no transparency
+void blitRow(uint16_t* output, const uint16_t* input, axis_index_t length, uint16_t transparentColor);
+
+/// \brief Blends row of pixels over the output, using their alpha. Runs of
+/// fully transparent pixels are skipped and runs of opaque ones are copied,
+/// so only partially transparent pixels (usually edges) are blended.
+/// @param output Target row, at the first pixel to be written.
+/// @param input Source row, at the first pixel to be blended.
+/// @param alpha Alpha (0-255) of the source pixels.
+/// @param length Number of pixels.
+void blendRow(uint16_t* output, const uint16_t* input, const uint8_t* alpha, axis_index_t length);
+
+/// \brief Computes opaque spans of decoded RGB565 pixels block, so drawing
+/// it with transparency doesn't need to check each pixel. Stored as single 
+/// block: `height + 1` offsets (counted in elements, from the block start)
+/// of the first span for each row, then spans as pairs of start & end 
+/// (exclusive) columns; spans of row `y` are between offsets `y` and `y + 1`.
+/// @param sizeInBytes (output) size of the returned block
+/// @return Allocated block (to be freed with `delete[]`), or null pointer 
+/// on allocation failure or if there are too many spans.
+uint16_t* computeOpaqueSpans(const uint16_t* pixels, axis_index_t width, axis_index_t height, uint16_t transparentColor, size_t& sizeInBytes);
+
+/// \brief Draws part of decoded RGB565 pixels block (top-to-bottom rows) 
+/// to the surface, limited to the clip area (in target coordinates).
+/// @param target Surface to draw on.
+/// @param pixels Pixels block, as returned by `readPixels`.
+/// @param width Width of the block
+/// @param height Height of the block
+/// @param x horizontal axis target position offset
+/// @param y vertical axis target position offset
+/// @param transparentColor transparent color (RGB565), or 0 for no transparency
+/// @param clip Area of the target to limit drawing to.
+void draw(const Surface& target, const uint16_t* pixels, axis_index_t width, axis_index_t height, int16_t targetX, int16_t targetY, uint16_t transparentColor, const Rect& clip);
+
+/// \brief Draws part of decoded RGB565 pixels block with transparency, 
+/// copying only its opaque spans, as computed by `computeOpaqueSpans`.
+void draw(const Surface& target, const uint16_t* pixels, const uint16_t* spans, axis_index_t width, axis_index_t height, int16_t targetX, int16_t targetY, const Rect& clip);
+
+/// \brief Draws part of decoded RGB565 pixels block with alpha, blending
+/// it over the target, see `blendRow`.
+/// @param alpha Alpha values block, laid out as the pixels.
+void draw(const Surface& target, const uint16_t* pixels, const uint8_t* alpha, axis_index_t width, axis_index_t height, int16_t targetX, int16_t targetY, const Rect& clip);
 
 }
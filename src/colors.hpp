@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <array>
 #include <algorithm> // min, max
 
 namespace colors {
@@ -48,12 +50,19 @@ constexpr HSL toHSL(RGB rgb) {
 	);
 }
 
-// TODO: test if this is more optimal than toHSL(toRGH(x))
+constexpr inline uint8_t expand5(uint8_t value) {
+	return (value << 3) | (value >> 2);
+}
+
+constexpr inline uint8_t expand6(uint8_t value) {
+	return (value << 2) | (value >> 4);
+}
+
 constexpr HSL toHSL(uint16_t rgb565) {
 	return toHSL(
-		float(rgb565) / 0b1111100000000000,
-		float(rgb565) / 0b0000011111100000,
-		float(rgb565) / 0b0000000000011111
+		float(rgb565 >> 11) / 0b11111,
+		float((rgb565 >> 5) & 0b111111) / 0b111111,
+		float(rgb565 & 0b11111) / 0b11111
 	);
 }
 
@@ -87,11 +96,13 @@ constexpr RGB toRGB(HSL hsl) {
 	};
 }
 
+/// Converts RGB565 to RGB888, replicating high bits into low ones,
+/// so full intensity maps to 255 (and `to565` gives back the same color).
 constexpr inline RGB toRGB(uint16_t rgb565) {
 	return {
-		static_cast<uint8_t>((rgb565 & 0b1111100000000000) >> 8), // r
-		static_cast<uint8_t>((rgb565 & 0b0000011111100000) >> 3), // g
-		static_cast<uint8_t>((rgb565 & 0b0000000000011111) << 3), // b
+		expand5(rgb565 >> 11),
+		expand6((rgb565 >> 5) & 0b111111),
+		expand5(rgb565 & 0b11111),
 	};
 }
 
@@ -115,6 +126,240 @@ constexpr HSL interpolateHSL(const HSL& a, const HSL& b, float ratio) {
 	};
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Fixed-point
+
+/// Hue steps of fixed-point colors: 256 per each of 6 sectors (60°).
+constexpr uint16_t hueSteps = 6 * 256;
+
+/// HSL color in integers, with hue in `hueSteps` and saturation and
+/// lightness in 0-255 (instead of degrees and percents).
+struct FixedHSL {
+	uint16_t h;
+	uint8_t s, l;
+};
+
+/// HSV color in integers, with hue in `hueSteps` and saturation and
+/// value in 0-255.
+struct FixedHSV {
+	uint16_t h;
+	uint8_t s, v;
+};
+
+namespace {
+	/// Hue of color, given its largest channel and (non-zero) chroma.
+	constexpr uint16_t fixedHue(RGB rgb, uint8_t maxColor, uint8_t chroma) {
+		int32_t h;
+		if (maxColor == rgb.r) {
+			h = (int32_t(rgb.g) - rgb.b) * 256 / chroma;
+		}
+		else if (maxColor == rgb.g) {
+			h = 512 + (int32_t(rgb.b) - rgb.r) * 256 / chroma;
+		}
+		else {
+			h = 1024 + (int32_t(rgb.r) - rgb.g) * 256 / chroma;
+		}
+		return h < 0 ? h + hueSteps : h;
+	}
+
+	/// Color of given hue, chroma and smallest channel.
+	constexpr RGB fixedHue2RGB(uint16_t h, uint8_t chroma, uint8_t minColor) {
+		const uint16_t fraction = h & 0xFF;
+		const uint8_t rising  = minColor + ((chroma * fraction + 128) >> 8);
+		const uint8_t falling = minColor + ((chroma * (256 - fraction) + 128) >> 8);
+		const uint8_t top = minColor + chroma;
+		switch (h >> 8) {
+			case 0:  return {top, rising, minColor};
+			case 1:  return {falling, top, minColor};
+			case 2:  return {minColor, top, rising};
+			case 3:  return {minColor, falling, top};
+			case 4:  return {rising, minColor, top};
+			default: return {top, minColor, falling};
+		}
+	}
+}
+
+constexpr FixedHSL toFixedHSL(RGB rgb) {
+	const uint8_t maxColor = std::max({rgb.r, rgb.g, rgb.b});
+	const uint8_t minColor = std::min({rgb.r, rgb.g, rgb.b});
+	const uint16_t sum = maxColor + minColor;
+	const uint8_t chroma = maxColor - minColor;
+	const uint8_t l = (sum + 1) >> 1;
+	if (chroma == 0) {
+		return {0, 0, l};
+	}
+	const uint16_t divisor = sum <= 255 ? sum : 510 - sum;
+	return {
+		fixedHue(rgb, maxColor, chroma),
+		static_cast<uint8_t>((chroma * 255 + divisor / 2) / divisor),
+		l
+	};
+}
+
+constexpr inline FixedHSL toFixedHSL(uint16_t rgb565) {
+	return toFixedHSL(toRGB(rgb565));
+}
+
+constexpr RGB toRGB(FixedHSL hsl) {
+	const int16_t distance = 2 * hsl.l - 255;
+	const uint8_t chroma = ((255 - (distance < 0 ? -distance : distance)) * hsl.s + 127) / 255;
+	return fixedHue2RGB(hsl.h, chroma, hsl.l - (chroma + 1) / 2);
+}
+
+constexpr FixedHSV toFixedHSV(RGB rgb) {
+	const uint8_t maxColor = std::max({rgb.r, rgb.g, rgb.b});
+	const uint8_t chroma = maxColor - std::min({rgb.r, rgb.g, rgb.b});
+	if (chroma == 0) {
+		return {0, 0, maxColor};
+	}
+	return {
+		fixedHue(rgb, maxColor, chroma),
+		static_cast<uint8_t>((chroma * 255 + maxColor / 2) / maxColor),
+		maxColor
+	};
+}
+
+constexpr inline FixedHSV toFixedHSV(uint16_t rgb565) {
+	return toFixedHSV(toRGB(rgb565));
+}
+
+constexpr RGB toRGB(FixedHSV hsv) {
+	const uint8_t chroma = (hsv.v * hsv.s + 127) / 255;
+	return fixedHue2RGB(hsv.h, chroma, hsv.v - chroma);
+}
+
+/// Interpolates colors, with ratio (0-256) being weight of the second one.
+constexpr FixedHSL interpolateHSL(const FixedHSL& a, const FixedHSL& b, uint16_t ratio) {
+	return {
+		static_cast<uint16_t>(a.h + (((int32_t(b.h) - a.h) * ratio) >> 8)),
+		static_cast<uint8_t>(a.s + (((int16_t(b.s) - a.s) * ratio) >> 8)),
+		static_cast<uint8_t>(a.l + (((int16_t(b.l) - a.l) * ratio) >> 8)),
+	};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RGB565 kernels (SWAR)
+//
+// Kernels below process two RGB565 pixels packed in 32-bit word (first one in
+// lower half). Each channel is moved into own 16 bits lanes, so it's scaled
+// for both pixels with single multiplication, without carries between them.
+// Weights are 0-256, so the scaling is just a shift.
+
+namespace {
+	constexpr uint32_t lanes5 = 0x001F001F;
+	constexpr uint32_t lanes6 = 0x003F003F;
+	constexpr uint32_t lanesHalf = 0x00800080; // for rounding
+}
+
+constexpr inline uint32_t pack565x2(uint16_t first, uint16_t second) {
+	return first | (static_cast<uint32_t>(second) << 16);
+}
+
+/// Converts 0-255 alpha into 0-256 weight used by the kernels.
+constexpr inline uint16_t toWeight(uint8_t alpha) {
+	return alpha + (alpha >> 7);
+}
+
+/// Blends pairs of RGB565 pixels, with weight (0-256) of the first ones.
+constexpr inline uint32_t blend565x2(uint32_t a, uint32_t b, uint16_t weight) {
+	const uint16_t rest = 256 - weight;
+	const uint32_t r = (((a >> 11) & lanes5) * weight + ((b >> 11) & lanes5) * rest + lanesHalf) >> 8;
+	const uint32_t g = (((a >> 5)  & lanes6) * weight + ((b >> 5)  & lanes6) * rest + lanesHalf) >> 8;
+	const uint32_t bl = ((a        & lanes5) * weight + (b         & lanes5) * rest + lanesHalf) >> 8;
+	return ((r & lanes5) << 11) | ((g & lanes6) << 5) | (bl & lanes5);
+}
+
+/// Interpolates pairs of RGB565 pixels, with ratio (0-256) being weight of the second ones.
+constexpr inline uint32_t lerp565x2(uint32_t a, uint32_t b, uint16_t ratio) {
+	return blend565x2(b, a, ratio);
+}
+
+/// Scales brightness of pair of RGB565 pixels, by level (0-256).
+constexpr inline uint32_t scale565x2(uint32_t pixels, uint16_t level) {
+	const uint32_t r = (((pixels >> 11) & lanes5) * level + lanesHalf) >> 8;
+	const uint32_t g = (((pixels >> 5)  & lanes6) * level + lanesHalf) >> 8;
+	const uint32_t b = ((pixels         & lanes5) * level + lanesHalf) >> 8;
+	return ((r & lanes5) << 11) | ((g & lanes6) << 5) | (b & lanes5);
+}
+
+/// Blends two RGB565 colors, with alpha (0-255) being weight of the first one.
+constexpr inline uint16_t blend565(uint16_t a, uint16_t b, uint8_t alpha) {
+	return blend565x2(a, b, toWeight(alpha));
+}
+
+/// Scales brightness of RGB565 color, by level (0-256).
+constexpr inline uint16_t scale565(uint16_t color, uint16_t level) {
+	return scale565x2(color, level);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Gamma
+
+namespace {
+	// Slow, but constexpr math, for generating tables at compile time.
+
+	constexpr double logarithm(double x) {
+		int exponent = 0;
+		while (x >= 2) { x /= 2; exponent++; }
+		while (x < 1)  { x *= 2; exponent--; }
+		// ln(x) = 2 atanh((x - 1) / (x + 1)), converging fast for x in [1, 2)
+		const double y = (x - 1) / (x + 1);
+		double term = y;
+		double sum = 0;
+		for (int n = 1; n < 40; n += 2) {
+			sum += term / n;
+			term *= y * y;
+		}
+		return 2 * sum + exponent * 0.6931471805599453;
+	}
+
+	constexpr double exponential(double x) {
+		// e^x = 2^k * e^r, with r in [0, ln 2)
+		int k = static_cast<int>(x / 0.6931471805599453);
+		if (x < 0) k--;
+		const double r = x - k * 0.6931471805599453;
+		double term = 1;
+		double sum = 1;
+		for (int n = 1; n < 20; n++) {
+			term *= r / n;
+			sum += term;
+		}
+		for (; k > 0; k--) sum *= 2;
+		for (; k < 0; k++) sum /= 2;
+		return sum;
+	}
+
+	constexpr double power(double base, double exponent) {
+		return base <= 0 ? 0 : exponential(exponent * logarithm(base));
+	}
+}
+
+/// Generates gamma correction table for channel values 0 to `maximum`,
+/// i.e. `gammaTable<31>(2.2)` for red or blue of RGB565.
+template <uint8_t maximum>
+constexpr std::array<uint8_t, maximum + 1> gammaTable(double gamma) {
+	std::array<uint8_t, maximum + 1> table {};
+	for (uint16_t i = 0; i <= maximum; i++) {
+		table[i] = static_cast<uint8_t>(power(double(i) / maximum, gamma) * maximum + 0.5);
+	}
+	return table;
+}
+
+constexpr double defaultGamma = 2.2;
+constexpr inline auto gamma5 = gammaTable<31>(defaultGamma);
+constexpr inline auto gamma6 = gammaTable<63>(defaultGamma);
+constexpr inline auto gamma8 = gammaTable<255>(defaultGamma);
+
+/// Applies gamma correction to RGB565 color (using default gamma tables).
+constexpr inline uint16_t gamma565(uint16_t color) {
+	return (gamma5[color >> 11] << 11) | (gamma6[(color >> 5) & 0b111111] << 5) | gamma5[color & 0b11111];
+}
+
+static_assert(toRGB(uint16_t(0xFFFF)).r == 255 && to565(toRGB(uint16_t(0x1234))) == 0x1234);
+static_assert(toRGB(toFixedHSL(RGB {255, 128, 0})).g == 128);
+static_assert(blend565(0xFFFF, 0x0000, 255) == 0xFFFF && blend565(0xFFFF, 0x0000, 0) == 0x0000);
+static_assert(gamma8[0] == 0 && gamma8[255] == 255 && gamma8[128] == 56);
+
 constexpr RGB white {255, 255, 255};
 constexpr RGB black {0, 0, 0};
 
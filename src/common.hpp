@@ -6,10 +6,12 @@
 #include <ESP8266WiFi.h> // ip4_addr_t
 #include <coredecls.h> // crc32
 
+#ifndef NATIVE // host-native build (see `native/`) is 64 bit most likely
 static_assert(sizeof(int*) == 4, 
 	"It's ESP/xtensa AVR, 32 bit project, the pointer should be 4 bytes long. "
 	"If you are using VS Code, see https://github.com/platformio/platformio-vscode-ide/issues/3284 related issues. "
 );
+#endif
 
 /// Type for number of milliseconds across Arduino functions like `millis()` or `delay(ms)`
 using millis_t = decltype(millis()); 
@@ -40,7 +42,7 @@ constexpr uint32_t hashLogCompStr(const char (&str) [N]) {
 
 #include "config.hpp"
 
-#ifdef DEBUG
+#if DEBUG
 
 // Shared PROGMEM (sub)strings could be reused, but for things as short as 
 // component name up to around 16 it isn't worth... Calling `Serial.println` 
@@ -85,12 +87,14 @@ constexpr uint32_t hashLogCompStr(const char (&str) [N]) {
 ////////////////////////////////////////////////////////////////////////////////
 // Some global externs for misc stuff
 
+#ifndef NATIVE // not available for host-native build (see `native/`)
 #include <ESP8266WebServer.h>
 #include <EEPROM.h>
 #include "webEncoded/WebCommonUtils.hpp"
 
 // Initialized in main
 extern ESP8266WebServer webServer;
+#endif
 
 // Get settings object (which is persisted in EEPROM)
 extern Settings* settings;
@@ -3,7 +3,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Main configuration
 
+#ifndef DEBUG // can be overridden by build flags, i.e. 0 to disable logging
 #define DEBUG LEVEL_DEBUG
+#endif
 constexpr auto debugLevel = DEBUG;
 
 USE_LOG_LEVEL_DEFAULT(LEVEL_DEBUG);
@@ -15,9 +17,16 @@ USE_LOG_LEVEL(Temperature,      LEVEL_INFO);
 USE_LOG_LEVEL(Pages,            LEVEL_TRACE);
 USE_LOG_LEVEL(BMP,              LEVEL_TRACE);
 
+/// Size of the display (in pixels)
+#define MATRIX_WIDTH 64
+#define MATRIX_HEIGHT 32
+
 /// Timeouts for networking
 constexpr unsigned long timeoutForConnectingWiFi = 5000; // ms
 
+/// Bytes budget for decoded frames cache (full 64x32 frame takes 4 KiB)
+constexpr size_t assetCacheBudget = 8 * 1024;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Settings structure (persisted in EEPROM)
 
@@ -41,9 +50,39 @@ struct Settings {
 		return changed;
 	}
 
+	////////////////////////////////////////
+	// 0x020 - 0x030: Thermometers
+
+	// Zeros (from before these were introduced) mean defaults.
+	struct {
+		uint16_t interval = 1000; // ms
+		uint8_t resolution = 12; // bits
+		uint8_t medianWindow = 3; // samples
+		uint16_t emaAlpha = 64; // 1/256 units
+		char _pad[10];
+	} thermometers;
+	static_assert(sizeof(thermometers) == 0x010);
+
+	////////////////////////////////////////
+	// 0x030 - 0x040: Display refresh
+
+	// Zeros (from before these were introduced) mean defaults.
+	struct {
+		uint16_t showTime = 30; // µs
+		uint8_t interval = 5; // ms
+		uint8_t nightInterval = 8; // ms
+		uint8_t uploadInterval = 10; // ms
+		uint8_t maxInterval = 10; // ms
+		uint8_t maxCpuShare = 25; // percent
+		uint8_t brightness = 127;
+		uint8_t nightBrightness = 127;
+		char _pad[7];
+	} display;
+	static_assert(sizeof(display) == 0x010);
+
 	////////////////////////////////////////
 
-	uint8_t _beforeNetworkPad[0x100 - 0x020];
+	uint8_t _beforeNetworkPad[0x100 - 0x040];
 	
 	////////////////////////////////////////
 	// 0x100 - 0x160: Some network and cloud settings.
@@ -102,6 +141,8 @@ struct Settings {
 		network.mode = Network::Mode::AP;
 	}
 };
+static_assert(0x020 == offsetof(Settings, thermometers));
+static_assert(0x030 == offsetof(Settings, display));
 static_assert(0x100 == offsetof(Settings, network));
 static_assert(0x160 == offsetof(Settings, cloud));
 static_assert(sizeof(Settings) == 0x200);
@@ -1,21 +1,27 @@
 #include "common.hpp"
 #define PxMATRIX_double_buffer false
 #include <PxMatrix.h>
-#include <Fonts/FreeSerifBold12pt7b.h>
 #include <Ticker.h>
 #include <ESP8266WiFi.h>
 #include <DallasTemperature.h> // for DS18B20 thermometer
 #include <LittleFS.h>
 #include "Network.hpp"
 #include "NTP.hpp"
-#include "pages/Page.hpp"
-#include "pages/Animation.hpp"
+#include "AssetCache.hpp"
+#include "Compositor.hpp"
+#include "DisplayRefresh.hpp"
+#include "History.hpp"
+#include "Metrics.hpp"
+#include "Scheduler.hpp"
+#include "Thermometers.hpp"
+#include "TimeService.hpp"
+#include "pages/Renderer.hpp"
 #include "pages/RequestHandler.hpp"
 #include "webEncoded/WebStaticContent.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// Pins & width for the display
+// Pins & timings for the display
 #define P_LAT 16
 #define P_A 5
 #define P_B 4
@@ -23,13 +29,11 @@
 #define P_D 12
 #define P_E 0
 #define P_OE 2
-#define MATRIX_WIDTH 64
-#define MATRIX_HEIGHT 32
-#define DISPLAY_INTERVAL 5
-#define DISPLAY_SHOW_TIME 30
 
 Ticker displayTicker;
 PxMATRIX display(MATRIX_WIDTH, MATRIX_HEIGHT, P_LAT, P_OE, P_A, P_B, P_C, P_D);
+Compositor compositor(MATRIX_WIDTH, MATRIX_HEIGHT);
+uint16_t displayShowTime = DisplayRefresh::Config().showTime; // µs, selected by the governor
 #define TEST_COLORS_ON_START 0
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -43,348 +47,127 @@ constexpr millis_t showIPtimeout = 20000;
 
 OneWire oneWire;
 DallasTemperature oneWireThermometers(&oneWire);
-float temperature = 0; // avg of last and current read (simplest noise reduction)
+Thermometers::Pipeline<DallasTemperature> thermometers(oneWireThermometers);
+float temperature = 0; // filtered value of the primary sensor
 
 ////////////////////////////////////////////////////////////////////////////////
 
-const GFXfont* fontById(uint8_t font) {
-	switch (font) {
-		// case 1:  return &FreeMono9pt7b;
-		// case 2:  return &FreeMono12pt7b;
-		// case 3:  return &FreeMonoBold9pt7b;
-		// case 4:  return &FreeMonoBold12pt7b;
-		// case 5:  return &FreeSans9pt7b;
-		// case 6:  return &FreeSans12pt7b;
-		// case 7:  return &FreeSansBold9pt7b;
-		// case 8:  return &FreeSansBold12pt7b;
-		// case 9:  return &FreeSerif9pt7b;
-		// case 10: return &FreeSerif12pt7b;
-		// case 11: return &FreeSerifBold9pt7b;
-		case 12: return &FreeSerifBold12pt7b;
-		// case 13: return &Picopixel
-		// case 14: return &Org_01
-		// case 15: return &TomThumb
-		default: return nullptr; // default 6x8 font will be used
-	}
+uint8_t* stackPointerOnSetup;
+std::ptrdiff_t getStackOffsetFromSetup() {
+	uint8_t stackVariable;
+	return stackPointerOnSetup - &stackVariable;
 }
 
-// TODO: refactor/encapsulate stuff into pages manager of some sort?
-/// Currently displayed page for pages system.
-/// Initialized with predefined stuff to display in case filesystem failure.
-pages::Page activePage = {
-	.duration = 0, // single page
-	.backgroundColors = {
-		.flag = 0,
-		.primary = colors::to565(colors::white),
-	},
-	.backgroundDuration = 0, // still frame
-	.analog = { .centerX = 255, }, // disabled
-	.sprites = {
-		{ .text = { /*.text = "FS FAIL?",*/ .x = 4, .y = 4, } },
-	}
-};
-millis_t lastPageChange;
-
-millis_t lastBackgroundFrame;
-millis_t lastSpriteFrame[pages::Page::maxSprites];
-uint8_t backgroundFrameIndex;
-uint8_t spriteFrameIndex[pages::Page::maxSprites];
-
-void changeActivePage(uint8_t id) {
-	activePage.loadById(id);
-	lastPageChange = millis();
-}
+////////////////////////////////////////////////////////////////////////////////
 
-void substitutePathVariables(char* output, const char* raw) {
-	for (const char* fp = raw; *fp; fp++) {
-		if (*fp == '$') {
-			fp++;
-			switch (*fp) {
-				case 'M': /* month*/ {
-					char buffer[16];
-					std::time_t time = std::time({});
-					std::strftime(buffer, sizeof(buffer), "%B", std::localtime(&time));
-					buffer[0] += ('a' - 'A');
-					const char* vp = buffer;
-					while (*vp) *output++ = *vp++;
-					break;
-				}
-				case 'S': /* season */ {
-					std::time_t time = std::time({});
-					int m = std::localtime(&time)->tm_mon;
-					const char* vp = "winter";
-					if (m > 1) {
-						/**/ if (m < 5) vp = "spring";
-						else if (m < 8) vp = "summer";
-						else if (m < 11) vp = "fall";
-					}
-					while (*vp) *output++ = *vp++;
-					break;
-				}
-				case 'W': /* weather */ {
-					// TODO: weather (also consider how to express future weather)
-					const char* vp = "sunny";
-					while (*vp) *output++ = *vp++;
-					break;
-				}
-				default:
-					*output++ = *fp;
-					LOG_WARN(Pages, "Unknown path variable $%c", *fp);
-					break; // will fail to find the file most likely
-			}
-		}
-		else {
-			*output++ = *fp;
-		}
+void updateThermometer() {
+	thermometers.update(millis());
+	if (const auto* sensor = thermometers.primary()) {
+		temperature = sensor->value();
 	}
-	*output = 0;
-	// TODO: improve safety?
 }
 
-/// \brief Selects current frame for raw path, by substituting path variables 
-/// and resolving actual path (necessary if `Animation` struct file path
-/// or directory path provided). Frame index can be modified incremented,
-/// looping over max frames found (via anim/dir) if `goNextFrame` is true.
-/// \param rawPath raw path (can contain vars to replace) points to BMP file
-/// for still image, or `Animation` struct file or directory for dynamic
-/// \param frameIndex (reference) current (valid) frame index of the animation
-/// \param goNextFrame whenever the frame index should be pre-incremented 
-/// and next frame image file fetched.
-/// \return File for current frame (if found), should fail when cast to boolean on error
-File selectCurrentFrameForFile(const char* rawPath, uint8_t& frameIndex, bool goNextFrame) {
-	LOG_TRACE(Pages, "selectCurrentFrameForFile(\"%s\", &%u, %u)", rawPath, frameIndex, goNextFrame);
-
-	using namespace pages;
-	char basePath[24];
-	substitutePathVariables(basePath, rawPath);
-
-	File file = LittleFS.open(basePath, "r");
-	if (!file) {
-		LOG_DEBUG(Pages, "Failed to open base path '%s'", basePath);
-		return file;
-	}
-	if (file.isFile()) {
-		uint16_t signature;
-		file.read(reinterpret_cast<uint8_t*>(&signature), sizeof(signature));
-		file.seek(0, SeekSet);
-		switch (signature) {
-			case BMP::expectedSignature:
-				// Return the found BMP directly, effectively there is no other frames,
-				// even if there are other (even numbered) BMP files in the same directory.
-				return file;
-			case Animation::expectedSignature: {
-				Animation animation;
-				file.read(reinterpret_cast<uint8_t*>(&animation), sizeof(animation));
-				
-				if (goNextFrame) {
-					while (animation.frames[frameIndex].path[0]) {
-						if (frameIndex++ >= Animation::maxFrames) {
-							frameIndex = 0;
-							break;
-						}
-					}
-				}
-
-				const char* actualPath = animation.frames[frameIndex].path;
-
-				file.close();
-				file = LittleFS.open(actualPath, "r");
-				if (!file) {
-					LOG_DEBUG(Pages, "Failed to open '%s'", actualPath);
-				}
-				return file;
-			}
-			default:
-				LOG_ERROR(Pages, "Invalid signature");
-				return File(); // so it evaluates to false on boolean operator
-		}
-	}
-	else /* directory */ {
-		char actualPath[32];
-		snprintf(
-			actualPath, sizeof(actualPath), "%s/%u.bmp", 
-			basePath,
-			frameIndex + (goNextFrame ? 1 : 0)
-		);
-
-		if (LittleFS.exists(actualPath)) {
-			frameIndex += (goNextFrame ? 1 : 0);
-		}
-		else {
-			if (goNextFrame) 
-				frameIndex = 0;
-			snprintf(
-				actualPath, sizeof(actualPath), "%s/0.bmp", 
-				basePath
-			);
-		}
-		LOG_TRACE(Pages, "frameIndex=%u", frameIndex);
+void configureThermometers() {
+	const auto& stored = settings->thermometers;
+	Thermometers::Config config;
+	if (stored.interval)     config.interval = stored.interval;
+	if (stored.resolution)   config.resolution = stored.resolution;
+	if (stored.medianWindow) config.medianWindow = stored.medianWindow;
+	if (stored.emaAlpha)     config.emaAlpha = stored.emaAlpha;
+	thermometers.configure(config);
+}
 
-		file.close();
-		file = LittleFS.open(actualPath, "r");
-		if (!file) {
-			LOG_DEBUG(Pages, "Failed to open '%s'", actualPath);
-		}
+void IRAM_ATTR refreshDisplay() {
+	const uint32_t start = micros();
+	display.display(displayShowTime);
+	Metrics::displayRefresh.observe(micros() - start);
+}
 
-		return file;
-	}
+void applyDisplayRefresh() {
+	const auto& state = DisplayRefresh::state();
+	displayShowTime = state.showTime;
+	display.setBrightness(state.brightness);
+	displayTicker.attach_ms(state.interval, refreshDisplay);
 }
 
-void updatePagesStuff() {
-	using namespace pages;
-	millis_t currentMillis = millis();
+void configureDisplayRefresh() {
+	const auto& stored = settings->display;
+	DisplayRefresh::Config config;
+	if (stored.showTime)        config.showTime = stored.showTime;
+	if (stored.interval)        config.interval = stored.interval;
+	if (stored.nightInterval)   config.nightInterval = stored.nightInterval;
+	if (stored.uploadInterval)  config.uploadInterval = stored.uploadInterval;
+	if (stored.maxInterval)     config.maxInterval = stored.maxInterval;
+	if (stored.maxCpuShare)     config.maxCpuShare = stored.maxCpuShare;
+	if (stored.brightness)      config.brightness = stored.brightness;
+	if (stored.nightBrightness) config.nightBrightness = stored.nightBrightness;
+	DisplayRefresh::configure(config);
+}
 
-	// Going to next pages
-	if (activePage.hasNextPage()) {
-		const auto durationFromLast = static_cast<uint16_t>(currentMillis - lastPageChange);
-		if (durationFromLast >= activePage.duration) {
-			changeActivePage(activePage.next);
-		}
+void updateDisplayRefresh() {
+	noInterrupts();
+	const uint32_t calls = Metrics::displayRefresh.count;
+	const uint64_t totalDuration = Metrics::displayRefresh.sum;
+	interrupts();
+	if (DisplayRefresh::update(calls, totalDuration, micros(), TimeService::now().isNight)) {
+		const auto& state = DisplayRefresh::state();
+		LOG_DEBUG(Display, "Refresh every %u ms (%s%s), brightness %u, CPU share %.1f%% (predicted %.1f%%)",
+			state.interval, DisplayRefresh::reasonName(state.reason), state.limited ? ", limited" : "",
+			state.brightness, state.measuredCpuShare * 100, state.predictedCpuShare * 100);
+		applyDisplayRefresh();
 	}
+}
 
-	// Background
-	bool goNextBackground = false;
-	if (activePage.backgroundDuration != 0) {
-		const auto durationFromLast = static_cast<uint16_t>(currentMillis - lastBackgroundFrame);
-		if (durationFromLast >= activePage.backgroundDuration) {
-			lastBackgroundFrame = currentMillis;
-			goNextBackground = true;
-		}
+void updateHistory() {
+	const auto& now = TimeService::now();
+	if (!now.isSynchronized()) {
+		return;
 	}
-	if (not activePage.usesBackgroundFromFile()) {
-		display.fillScreen(activePage.backgroundColors.primary);
-	}
-	else /* image(s) used */ {
-		LOG_TRACE(Pages, "Background:");
-		File file = selectCurrentFrameForFile(
-			activePage.backgroundPath, 
-			backgroundFrameIndex,
-			goNextBackground
-		);
-		if (file) {
-			BMP::drawToDisplay(file, 0, 0);
-			file.close();
-		}
-		else {
-			// TODO: error once?
-			LOG_ERROR(Pages, "Failed to select frame");
-		}
+	if (thermometers.primary()) {
+		History::record(now.time, temperature);
 	}
+}
 
-	// Sprites
-	for (uint8_t i = 0; i < Page::maxSprites; i++) {
-		const auto& sprite = activePage.sprites[i];
-		if (sprite.common.type == Sprite::Type::None) {
-			continue;
-		}
-		LOG_TRACE(Pages, "Sprite %u. type=%u x=%u y=%u", i, sprite.common.type, sprite.common.x, sprite.common.y);
-
-		// TODO: maybe rewrite it more object oriented way? 
-		//  Having sprites/background class have display method.
-		switch (sprite.common.type) {
-			case Sprite::Type::None:
-				// Skip not used sprites
-				break;
-			case Sprite::Type::Text:
-				display.setFont(fontById(sprite.text.font));
-				display.setTextColor(sprite.text.color);
-				display.setCursor(sprite.common.x, sprite.common.y);
-				display.print(sprite.text.text);
-				// TODO: dot size
-				break;
-			case Sprite::Type::Time: {
-				display.setFont(fontById(sprite.time.font));
-				display.setTextColor(sprite.time.color);
-				display.setCursor(sprite.common.x, sprite.common.y);
-
-				char buffer[32];
-				std::time_t time = std::time({});
-				std::tm* tm = sprite.time.useUTC ? std::gmtime(&time) : std::localtime(&time);
-				std::strftime(buffer, sizeof(buffer), sprite.time.format, tm);
-				
-				display.print(buffer);
-				// TODO: dot size, colon fix, blinking colons
-				break;
-			}
-			case Sprite::Type::Temperature: {
-				display.setFont(fontById(sprite.temperature.font));
-				display.setCursor(sprite.common.x, sprite.common.y);
+void handleWebClients() {
+	Metrics::ScopedTimer timer(Metrics::handleClient);
+	webServer.handleClient();
+	// TODO: show IP on display for a while or until connected
+}
 
-				char buffer[16];
-				sprintf(buffer, "%*.f", sprite.temperature.precision, temperature);
-				// TODO: other temperature sources
-				// TODO: ...
+/// \brief Parses numeric config argument (if present) into the field, clamped
+/// to its valid range. Zero is kept as is, as it means default for the settings.
+/// \return true if the argument was present
+template <typename T>
+bool parseConfigArg(const char* name, T& field, long min, long max) {
+	const String& str = webServer.arg(name);
+	if (str.isEmpty()) {
+		return false;
+	}
+	const long value = atol(str.c_str());
+	field = static_cast<T>(value == 0 ? 0 : std::clamp(value, min, max));
+	return true;
+}
 
-				display.print(buffer);
-				// TODO: dot size, degree size, blinking colons
-				// TODO: degree size
+void registerTasks() {
+	// Time snapshot first, so all tasks of the pass see the same time
+	scheduler.addPeriodic("time", [] { TimeService::update(); }, 0, 1'000);
 
-				break;
-			}
-			case Sprite::Type::Image: {
-				bool goNextFrame = false;
-				if (sprite.image.frameDuration != 0) {
-					const auto durationFromLast = static_cast<uint16_t>(currentMillis - lastSpriteFrame[i]);
-					if (durationFromLast >= sprite.image.frameDuration) {
-						lastSpriteFrame[i] = currentMillis;
-						goNextFrame = true;
-					}
-				}
-				// TODO: use frame duration from animation file if present
-
-				File file = selectCurrentFrameForFile(
-					activePage.backgroundPath, 
-					spriteFrameIndex[i],
-					goNextFrame
-				);
-				if (file) {
-					BMP::drawToDisplay(file, sprite.common.x, sprite.common.y, sprite.image.transparentColor);
-					file.close();
-				}
-				else {
-					// TODO: error once?
-					LOG_ERROR(Pages, "Failed to select frame");
-				}
-
-				break;
-			}
-			case Sprite::Type::CustomChar: 
-				const auto xLimit = sprite.common.x + sprite.customChar.width;
-				const auto yLimit = sprite.common.y + sprite.customChar.height();
-				uint8_t i = 0;
-				uint8_t mask = 1;
-				display.startWrite();
-				for (uint8_t y = sprite.common.y; y < yLimit; y++) {
-					for (uint8_t x = sprite.common.x; x < xLimit; x++) {
-						if (sprite.customChar.data[i] & mask) {
-							display.writePixel(x, y, sprite.customChar.color);
-						}
-						mask <<= 1;
-						if (!mask) {
-							i += 1;
-							mask = 1;
-						}
-					}
-				}
-				display.endWrite();
-				break;
-		}
-	}
+	// Reload of the page after uploads, before it's rendered again
+	pages::reloadTask = scheduler.addDeadline("reload", pages::reloadActivePage, 20'000, Scheduler::Priority::High);
 
-	// Analog clock
-	{
-		// TODO: analog clock
-	}
+	// Rendering first, as the display should keep its cadence
+	scheduler.addPeriodic("render", pages::updatePagesStuff, 0, 20'000);
+	scheduler.addPeriodic("web", handleWebClients, 0, 50'000);
+
+	// Background work, one task per pass
+	scheduler.addPeriodic("thermometer", updateThermometer, 100, 5'000, Scheduler::Priority::Low);
+	scheduler.addPeriodic("ntp", NTP::update, 0, 2'000, Scheduler::Priority::Low);
+	scheduler.addPeriodic("history", updateHistory, 1000, 50'000, Scheduler::Priority::Low);
+	scheduler.addPeriodic("refresh", updateDisplayRefresh, 1000, 1'000, Scheduler::Priority::Low);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-uint8_t* stackPointerOnSetup;
-std::ptrdiff_t getStackOffsetFromSetup() {
-	uint8_t stackVariable;
-	return stackPointerOnSetup - &stackVariable;
-}
-
 void setup() {
 	delay(1000);
 
@@ -402,11 +185,8 @@ void setup() {
 	// Initialize display 
 	display.begin(8);
 	display.setFastUpdate(true);
-	displayTicker.attach_ms(DISPLAY_INTERVAL, [] {
-		display.display(DISPLAY_SHOW_TIME);
-	});
+	applyDisplayRefresh(); // defaults until settings are loaded
 	display.clearDisplay();
-	display.setBrightness(127);
 
 #if TEST_COLORS_ON_START
 	display.fillScreen(display.color565(255, 0, 0));
@@ -445,20 +225,12 @@ void setup() {
 		showIP = false;
 	}
 
-	// Initialize thermometer(s)
+	// Initialize thermometer(s), the bus is scanned by the task
 	oneWire.begin(D3);
-	oneWireThermometers.begin();
-	oneWireThermometers.requestTemperatures();
-	float t = oneWireThermometers.getTempCByIndex(0);
-	if (t == DEVICE_DISCONNECTED_C) {
-		LOG_ERROR(Temperature, "Not connected");
-	}
-	else {
-		temperature = t;
-		LOG_DEBUG(Temperature, "First read: %.1f", temperature);
-	}
-	oneWireThermometers.setWaitForConversion(true);
-	oneWireThermometers.requestTemperatures();
+	configureThermometers();
+
+	// Apply display refresh settings, the governor adjusts them by the task
+	configureDisplayRefresh();
 
 	// Initialize NTP
 	NTP::setup();
@@ -466,10 +238,13 @@ void setup() {
 	// Initialize file system
 	// LittleFS.setConfig(LittleFSConfig(/*autoFormat=*/ false));
 	LittleFS.begin();
+	History::setup();
 
 	// Initialize pages system
-	std::strncpy(activePage.sprites[0].text.text, "FS FAIL", sizeof(pages::Sprite::Text::text));
-	changeActivePage(0);
+	TimeService::update();
+	pages::setup();
+	std::strncpy(pages::activePage.sprites[0].text.text, "FS FAIL", sizeof(pages::Sprite::Text::text));
+	pages::changeActivePage(0);
 
 	// Register server handlers
 	webServer.on(F("/"), []() {
@@ -481,8 +256,7 @@ void setup() {
 
 	webServer.on(F("/status"), []() {
 		char timeString[24];
-		std::time_t time = std::time({});
-		std::strftime(timeString, sizeof(timeString), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&time));
+		std::strftime(timeString, sizeof(timeString), "%Y-%m-%dT%H:%M:%SZ", &TimeService::now().utc);
 		
 		constexpr unsigned int bufferLength = 256;
 		char buffer[bufferLength];
@@ -491,11 +265,23 @@ void setup() {
 			"{"
 				"\"temperature\":%.2f,"
 				"\"timestamp\":\"%s\","
-				"\"rssi\":%d"
+				"\"rssi\":%d,"
+				"\"assetCache\":{"
+					"\"hits\":%u,"
+					"\"misses\":%u,"
+					"\"evictions\":%u,"
+					"\"usedBytes\":%u,"
+					"\"budget\":%u"
+				"}"
 			"}",
 			temperature,
 			timeString,
-			WiFi.RSSI()
+			WiFi.RSSI(),
+			assetCache.getStats().hits,
+			assetCache.getStats().misses,
+			assetCache.getStats().evictions,
+			assetCache.getUsedBytes(),
+			assetCache.getBudget()
 		); // not `snprintf_P` for better performance
 		if (ret < 0 || static_cast<unsigned int>(ret) >= bufferLength) {
 			webServer.send(500, WEB_CONTENT_TYPE_TEXT_HTML, F("Response buffer exceeded"));
@@ -505,6 +291,9 @@ void setup() {
 		}
 	});
 
+	webServer.on(F("/metrics"), Metrics::handleRequest);
+	webServer.on(F("/history"), History::handleRequest);
+
 	webServer.on(F("/config"), []() {
 		if constexpr (debugLevel >= LEVEL_DEBUG) {
 			// Allow changing time for testing
@@ -525,6 +314,37 @@ void setup() {
 					.tv_usec = 500'000,
 				};
 				settimeofday(&tv, nullptr);
+				NTP::reset(); // otherwise the clock would be stepped back right away
+			}
+		}
+
+		// Handle thermometers config
+		{
+			auto& stored = settings->thermometers;
+			bool changes = false;
+			changes |= parseConfigArg("thermometers.interval",     stored.interval, 1, 60'000);
+			changes |= parseConfigArg("thermometers.resolution",   stored.resolution, 9, 12);
+			changes |= parseConfigArg("thermometers.medianWindow", stored.medianWindow, 1, Thermometers::Filter::maxMedianWindow);
+			changes |= parseConfigArg("thermometers.emaAlpha",     stored.emaAlpha, 1, 256);
+			if (changes) {
+				configureThermometers();
+			}
+		}
+
+		// Handle display refresh config
+		{
+			auto& stored = settings->display;
+			bool changes = false;
+			changes |= parseConfigArg("display.showTime",        stored.showTime, 1, 1000);
+			changes |= parseConfigArg("display.interval",        stored.interval, 1, 100);
+			changes |= parseConfigArg("display.nightInterval",   stored.nightInterval, 1, 100);
+			changes |= parseConfigArg("display.uploadInterval",  stored.uploadInterval, 1, 100);
+			changes |= parseConfigArg("display.maxInterval",     stored.maxInterval, 1, 100);
+			changes |= parseConfigArg("display.maxCpuShare",     stored.maxCpuShare, 1, 100);
+			changes |= parseConfigArg("display.brightness",      stored.brightness, 1, 255);
+			changes |= parseConfigArg("display.nightBrightness", stored.nightBrightness, 1, 255);
+			if (changes) {
+				configureDisplayRefresh();
 			}
 		}
 
@@ -577,38 +397,13 @@ void setup() {
 		webServer.send(404, WEB_CONTENT_TYPE_TEXT_PLAIN, PSTR("Not found\n\n"));
 	});
 	webServer.begin();
+
+	registerTasks();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-#define UPDATE_EVERY(interval)          \
-	for(                                \
-		static millis_t prev = 0;       \
-		currentMillis - prev > interval;\
-		currentMillis = prev = millis() \
-	)
-
 void loop() {
-	millis_t currentMillis = millis();
-
-	webServer.handleClient();
-
-	// TODO: show IP on display for a while or until connected
-
-	UPDATE_EVERY(60 * 60 * 1000) {
-		NTP::update();
-	}
-
-	// Update thermometer
-	if (oneWireThermometers.isConversionComplete()) {
-		// Update thermometer read
-		float t = oneWireThermometers.getTempCByIndex(0);
-		if (t != DEVICE_DISCONNECTED_C) {
-			temperature = (temperature + t) / 2;
-		}
-
-		oneWireThermometers.requestTemperatures();
-	}
-
-	updatePagesStuff();
+	Metrics::ScopedTimer loopTimer(Metrics::loopIteration);
+	scheduler.run();
 }
@@ -0,0 +1,90 @@
+#include "packed.hpp"
+#include <iterator> // size
+#include "bitmap.hpp" // rowBuffer, blitRow
+
+namespace Packed {
+
+bool readHeader(Stream& file, Header& header) {
+	int ret = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header));
+	if (ret != sizeof(header)) [[unlikely]] {
+		LOG_DEBUG(BMP, "Header too short");
+		return false;
+	}
+	if (header.signature != expectedSignature) [[unlikely]] {
+		LOG_DEBUG(BMP, "Invalid signature");
+		return false;
+	}
+	if (header.version != expectedVersion) [[unlikely]] {
+		LOG_DEBUG(BMP, "Unsupported version");
+		return false;
+	}
+	if (header.width == 0 || header.height == 0 || header.width > INT16_MAX || header.height > INT16_MAX) [[unlikely]] {
+		LOG_DEBUG(BMP, "Invalid width or height");
+		return false;
+	}
+	if (header.frameCount == 0) [[unlikely]] {
+		LOG_DEBUG(BMP, "No frames");
+		return false;
+	}
+	return true;
+}
+
+bool seekFrame(File& file, const Header& header, uint16_t frameIndex, FrameEntry& entry) {
+	if (frameIndex >= header.frameCount) [[unlikely]] {
+		return false;
+	}
+	if (!file.seek(offsetOfFrameEntry(frameIndex), SeekSet)) [[unlikely]] {
+		return false;
+	}
+	if (file.read(reinterpret_cast<uint8_t*>(&entry), sizeof(entry)) != sizeof(entry)) [[unlikely]] {
+		LOG_DEBUG(BMP, "Frames table too short");
+		return false;
+	}
+	const size_t expectedSize = static_cast<size_t>(header.width) * header.height * sizeof(uint16_t);
+	if (!(entry.flags & FrameEntry::isDelta) && entry.size != expectedSize) [[unlikely]] {
+		LOG_DEBUG(BMP, "Invalid frame size");
+		return false;
+	}
+	return file.seek(entry.offset, SeekSet);
+}
+
+bool readPixels(Stream& file, const Header& header, uint16_t* output) {
+	const size_t length = static_cast<size_t>(header.width) * header.height * sizeof(uint16_t);
+	if (file.readBytes(reinterpret_cast<uint8_t*>(output), length) != length) [[unlikely]] {
+		LOG_DEBUG(BMP, "Data exhausted before expected end");
+		return false;
+	}
+	return true;
+}
+
+bool draw(const Surface& target, File& file, const Header& header, int16_t targetX, int16_t targetY, uint16_t transparentColor, const Rect& clip) {
+	const auto width = static_cast<int16_t>(header.width);
+	const auto height = static_cast<int16_t>(header.height);
+	const Rect area = Rect::fromSize(targetX, targetY, width, height)
+		.intersection(clip)
+		.intersection(target.bounds());
+	if (area.isEmpty()) {
+		return true;
+	}
+	if (area.width() > static_cast<int16_t>(std::size(BMP::rowBuffer))) [[unlikely]] {
+		LOG_ERROR(BMP, "Target too wide for row buffer");
+		return false;
+	}
+
+	const size_t rowLengthInBytes = width * sizeof(uint16_t);
+	const size_t pixelsOffset = file.position() + (area.x0 - targetX) * sizeof(uint16_t);
+	const size_t lengthInBytes = area.width() * sizeof(uint16_t);
+	for (int16_t y = area.y0; y < area.y1; y++) {
+		const size_t storedRowIndex = y - targetY;
+		if (!file.seek(pixelsOffset + storedRowIndex * rowLengthInBytes, SeekSet) ||
+			file.read(reinterpret_cast<uint8_t*>(BMP::rowBuffer), lengthInBytes) != static_cast<int>(lengthInBytes)
+		) [[unlikely]] {
+			LOG_DEBUG(BMP, "Data exhausted before expected end");
+			return false;
+		}
+		BMP::blitRow(target.row(y) + area.x0, BMP::rowBuffer, area.width(), transparentColor);
+	}
+	return true;
+}
+
+}
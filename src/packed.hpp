@@ -0,0 +1,131 @@
+#pragma once
+
+#include "common.hpp"
+#include <FS.h> // File
+#include "Surface.hpp"
+
+/// \brief Packed multi-frame animation container: header, frames table
+/// and contiguous RGB565 frames data, all in single file, so switching 
+/// frames is just seeking on already open file.
+///
+/// Layout: `Header`, then `Header::frameCount` of `FrameEntry`, then frames 
+/// data (at offsets pointed by the entries), each frame being `width * height`
+/// of RGB565 pixels, with rows ordered top-to-bottom, without padding.
+///
+/// Frames can be delta encoded (flagged in the entry), relative to previous
+/// frame: `uint16_t` count of changed rectangles, then for each rectangle
+/// `DeltaRect` followed by its pixels (as for regular frame, but rectangle 
+/// sized). First frame should be regular one (keyframe).
+namespace Packed {
+
+static constexpr uint16_t expectedSignature = 0x4B50; // 'PK'
+static constexpr uint8_t expectedVersion = 1;
+
+#pragma pack(push, 1)
+struct Header {
+	static constexpr uint8_t hasDeltaFrames = 1 << 0;
+
+	uint16_t signature = expectedSignature;
+	uint8_t version = expectedVersion;
+	uint8_t flags;
+	uint16_t width;
+	uint16_t height;
+	uint16_t frameCount;
+	uint16_t reserved;
+};
+struct FrameEntry {
+	static constexpr uint16_t isDelta = 1 << 0;
+
+	uint32_t offset; // from the start of the file
+	uint32_t size; // in bytes
+	uint16_t duration; // ms, or 0 to use default
+	uint16_t flags;
+};
+struct DeltaRect {
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+};
+#pragma pack(pop)
+static_assert(sizeof(Header) == 12);
+static_assert(sizeof(FrameEntry) == 12);
+static_assert(sizeof(DeltaRect) == 8);
+
+inline constexpr size_t offsetOfFrameEntry(uint16_t frameIndex) {
+	return sizeof(Header) + frameIndex * sizeof(FrameEntry);
+}
+
+/// \brief Reads and validates container header.
+/// @param file Handle for the open container file, positioned at start.
+/// @param header Output header
+/// @return true on success, false otherwise
+bool readHeader(Stream& file, Header& header);
+
+/// \brief Reads entry of frames table for given frame and seeks to its data.
+/// @param file Handle for the open container file.
+/// @param header Header read from the file before.
+/// @param frameIndex Index of the frame.
+/// @param entry Output frame entry.
+/// @return true on success, false otherwise
+bool seekFrame(File& file, const Header& header, uint16_t frameIndex, FrameEntry& entry);
+
+/// \brief Reads frame pixels into continuous RGB565 block.
+/// Only for regular frames (not delta encoded ones).
+/// @param file Handle for the open container file, positioned at the frame data.
+/// @param header Header read from the file before.
+/// @param output Buffer for at least `width * height` pixels.
+/// @return true on success, false otherwise
+bool readPixels(Stream& file, const Header& header, uint16_t* output);
+
+/// \brief Applies delta encoded frame onto previous frame pixels.
+/// @param file Handle for the open container file, positioned at the frame data.
+/// @param header Header read from the file before.
+/// @param pixels Decoded previous frame (`width * height`), updated in place.
+/// @param onChanged Callback called with each changed rectangle (`Rect`, in frame coordinates).
+/// @return true on success, false otherwise (pixels might be partially updated)
+template <typename Callback>
+bool applyDelta(Stream& file, const Header& header, uint16_t* pixels, Callback&& onChanged) {
+	uint16_t count;
+	if (file.readBytes(reinterpret_cast<uint8_t*>(&count), sizeof(count)) != sizeof(count)) [[unlikely]] {
+		return false;
+	}
+	const Rect bounds = Rect::fromSize(0, 0, header.width, header.height);
+	while (count--) {
+		DeltaRect delta;
+		if (file.readBytes(reinterpret_cast<uint8_t*>(&delta), sizeof(delta)) != sizeof(delta)) [[unlikely]] {
+			return false;
+		}
+		const Rect rect = Rect::fromSize(delta.x, delta.y, delta.width, delta.height);
+		if (!bounds.contains(rect)) [[unlikely]] {
+			LOG_DEBUG(BMP, "Delta rectangle out of bounds");
+			return false;
+		}
+		// Rows of the rectangle go straight into the frame
+		const size_t rowLengthInBytes = delta.width * sizeof(uint16_t);
+		for (int16_t y = rect.y0; y < rect.y1; y++) {
+			uint8_t* row = reinterpret_cast<uint8_t*>(pixels + y * header.width + rect.x0);
+			if (file.readBytes(row, rowLengthInBytes) != rowLengthInBytes) [[unlikely]] {
+				LOG_DEBUG(BMP, "Data exhausted before expected end");
+				return false;
+			}
+		}
+		onChanged(rect);
+	}
+	return true;
+}
+
+/// \brief Draws frame directly from the file to the surface. Only rows and
+/// columns within the target are read. Only for regular frames (not delta 
+/// encoded ones).
+/// @param target Surface to draw on.
+/// @param file Handle for the open container file, positioned at the frame data.
+/// @param header Header read from the file before.
+/// @param x horizontal axis target position offset
+/// @param y vertical axis target position offset
+/// @param transparentColor transparent color (RGB565), or 0 for no transparency
+/// @param clip Area of the target to limit drawing to.
+/// @return true on success, false otherwise
+bool draw(const Surface& target, File& file, const Header& header, int16_t targetX, int16_t targetY, uint16_t transparentColor, const Rect& clip);
+
+}
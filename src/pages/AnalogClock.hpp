@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include "utils.hpp" // STRUCT_PADDING_BITS
 
 namespace pages {
 
@@ -16,6 +17,12 @@ struct AnalogClock {
 	uint8_t hourArrowLength;
 	uint8_t minuteArrowLength;
 	uint8_t secondArrowLength; // 0 to disable
+
+	bool antialiased : 1 = false; // true to blend edges of the hands with what is under
+	STRUCT_PADDING_BITS(7);
+
+	inline bool isEnabled() const { return centerX != 255 && centerY != 255; }
 };
+static_assert(sizeof(AnalogClock) == 14);
 
 }
@@ -0,0 +1,164 @@
+#include "ClockRenderer.hpp"
+#include "colors.hpp"
+
+namespace pages {
+
+uint8_t ClockRenderer::length(Hand hand) const {
+	switch (hand) {
+		case Hour:   return clock->hourArrowLength;
+		case Minute: return clock->minuteArrowLength;
+		default:     return clock->secondArrowLength;
+	}
+}
+
+uint16_t ClockRenderer::color(Hand hand) const {
+	switch (hand) {
+		case Hour:   return clock->hourArrowColor;
+		case Minute: return clock->minuteArrowColor;
+		default:     return clock->secondArrowColor;
+	}
+}
+
+template <typename Callback>
+void ClockRenderer::plot(Hand hand, uint8_t position, Callback callback) const {
+	// Line from the center to the tip, with coordinates in 1/256 of pixel
+	const int32_t x0 = clock->centerX << 8;
+	const int32_t y0 = clock->centerY << 8;
+	const int32_t dx = length(hand) * sin60(position) / 64; // Q1.14 to Q8
+	const int32_t dy = -length(hand) * cos60(position) / 64;
+
+	// Step along major axis, one pixel at time, interpolating the minor one
+	const bool steep = std::abs(dy) > std::abs(dx);
+	const int32_t major0 = steep ? y0 : x0;
+	const int32_t minor0 = steep ? x0 : y0;
+	const int32_t majorDelta = steep ? dy : dx;
+	const int32_t minorDelta = steep ? dx : dy;
+	const int16_t steps = (std::abs(majorDelta) + 128) >> 8;
+	const int8_t direction = majorDelta < 0 ? -1 : 1;
+	const auto put = [&](int16_t major, int16_t minor, uint8_t coverage) {
+		if (steep) callback(minor, major, coverage);
+		else       callback(major, minor, coverage);
+	};
+	for (int16_t i = 0; i <= steps; i++) {
+		const int16_t major = (major0 >> 8) + i * direction;
+		const int32_t minor = minor0 + (steps ? minorDelta * i / steps : 0);
+		if (clock->antialiased) {
+			// Split between two pixels by distance (like Xiaolin Wu's algorithm)
+			const uint8_t fraction = minor & 0xFF;
+			put(major, minor >> 8, 255 - fraction);
+			if (fraction) {
+				put(major, (minor >> 8) + 1, fraction);
+			}
+		}
+		else {
+			put(major, (minor + 128) >> 8, 255);
+		}
+	}
+}
+
+template <typename Callback>
+void ClockRenderer::plotAll(const uint8_t* positions, Callback callback) const {
+	for (uint8_t i = Hour; i < handsCount; i++) {
+		const Hand hand = static_cast<Hand>(i);
+		if (length(hand) == 0) {
+			continue;
+		}
+		const uint16_t handColor = color(hand);
+		plot(hand, positions[hand], [&](int16_t x, int16_t y, uint8_t coverage) {
+			callback(x, y, handColor, coverage);
+		});
+	}
+	callback(clock->centerX, clock->centerY, clock->centerColor, 255);
+}
+
+Rect ClockRenderer::bounds(const uint8_t* positions) const {
+	Rect result = Rect::fromSize(clock->centerX, clock->centerY, 1, 1);
+	for (uint8_t i = Hour; i < handsCount; i++) {
+		const Hand hand = static_cast<Hand>(i);
+		if (length(hand) == 0) {
+			continue;
+		}
+		// Tip, with margin for rounding and anti-aliasing
+		const int16_t x = clock->centerX + length(hand) * sin60(positions[hand]) / (1 << 14);
+		const int16_t y = clock->centerY - length(hand) * cos60(positions[hand]) / (1 << 14);
+		result = result.united(Rect { 
+			static_cast<int16_t>(x - 2), static_cast<int16_t>(y - 2), 
+			static_cast<int16_t>(x + 3), static_cast<int16_t>(y + 3)
+		});
+	}
+	return result;
+}
+
+void ClockRenderer::reset(const AnalogClock& clock) {
+	this->clock = clock.isEnabled() ? &clock : nullptr;
+	drawn = false;
+	std::fill(std::begin(positions), std::end(positions), 0);
+	std::fill(std::begin(previous), std::end(previous), 0);
+}
+
+bool ClockRenderer::update(const std::tm& time) {
+	const uint8_t current[handsCount] = {
+		static_cast<uint8_t>((time.tm_hour % 12) * 5 + time.tm_min / 12),
+		static_cast<uint8_t>(time.tm_min),
+		static_cast<uint8_t>(clock->secondArrowLength ? time.tm_sec % 60 : 0),
+	};
+	if (drawn && std::equal(std::begin(current), std::end(current), positions)) {
+		return false;
+	}
+	std::copy(std::begin(positions), std::end(positions), previous);
+	std::copy(std::begin(current), std::end(current), positions);
+	return true;
+}
+
+void ClockRenderer::erasePrevious(Compositor& compositor) const {
+	if (!drawn) {
+		return;
+	}
+	const Surface frame = compositor.frameSurface();
+	const Surface background = compositor.backgroundSurface();
+	const Rect area = frame.bounds();
+	plotAll(previous, [&](int16_t x, int16_t y, uint16_t, uint8_t) {
+		if (area.contains(Rect::fromSize(x, y, 1, 1))) {
+			frame.row(y)[x] = background.row(y)[x];
+		}
+	});
+}
+
+void ClockRenderer::draw(Compositor& compositor, const Rect& clip) const {
+	const Surface frame = compositor.frameSurface();
+	const Rect area = clip.intersection(frame.bounds());
+	plotAll(positions, [&](int16_t x, int16_t y, uint16_t color, uint8_t coverage) {
+		if (area.contains(Rect::fromSize(x, y, 1, 1))) {
+			uint16_t& pixel = frame.row(y)[x];
+			pixel = coverage == 255 ? color : colors::blend565(color, pixel, coverage);
+		}
+	});
+}
+
+void ClockRenderer::drawOutside(Compositor& compositor, const Damage& damage) const {
+	const Surface frame = compositor.frameSurface();
+	const Rect area = frame.bounds();
+	plotAll(positions, [&](int16_t x, int16_t y, uint16_t color, uint8_t coverage) {
+		const Rect pixel = Rect::fromSize(x, y, 1, 1);
+		if (area.contains(pixel) && !damage.intersects(pixel)) {
+			uint16_t& value = frame.row(y)[x];
+			value = coverage == 255 ? color : colors::blend565(color, value, coverage);
+		}
+	});
+}
+
+void ClockRenderer::presentMoved(Compositor& compositor, PxMATRIX& display) {
+	const Surface frame = compositor.frameSurface();
+	const Rect area = frame.bounds();
+	const auto push = [&](int16_t x, int16_t y, uint16_t, uint8_t) {
+		if (area.contains(Rect::fromSize(x, y, 1, 1))) {
+			display.drawPixelRGB565(x, y, frame.row(y)[x]);
+		}
+	};
+	if (drawn) {
+		plotAll(previous, push);
+	}
+	plotAll(positions, push);
+	drawn = true;
+}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "common.hpp"
+#include "Rect.hpp"
+#include "Compositor.hpp"
+#include "AnalogClock.hpp"
+#include "Damage.hpp"
+#include <array>
+#include <ctime>
+
+namespace pages {
+
+/// Fixed-point sine table (Q1.14), for angles in 1/60 of full turn (clock positions).
+constexpr std::array<int16_t, 60> sineTable = [] {
+	std::array<int16_t, 60> table {};
+	constexpr double pi = 3.14159265358979323846;
+	for (int i = 0; i < 60; i++) {
+		// Taylor series, as `std::sin` isn't `constexpr`
+		double x = 2 * pi * i / 60;
+		if (x > pi) x -= 2 * pi; // keep close to 0 for precision
+		double term = x;
+		double sum = 0;
+		for (int n = 1; n < 20; n += 2) {
+			sum += term;
+			term *= -x * x / ((n + 1) * (n + 2));
+		}
+		table[i] = static_cast<int16_t>(sum * (1 << 14) + (sum < 0 ? -0.5 : 0.5));
+	}
+	return table;
+}();
+static_assert(sineTable[0] == 0 && sineTable[15] == (1 << 14) && sineTable[45] == -(1 << 14));
+
+/// Sine of clock position (0-59), as Q1.14 fixed-point.
+constexpr int16_t sin60(uint8_t position) { return sineTable[position % 60]; }
+/// Cosine of clock position (0-59), as Q1.14 fixed-point.
+constexpr int16_t cos60(uint8_t position) { return sineTable[(position + 15) % 60]; }
+
+/// \brief Renders analog clock of the page, with hands drawn as lines from 
+/// the center (optionally anti-aliased). When the hands move, only pixels
+/// under previous hands are restored from the background layer and pushed
+/// to the display along with the new hands, instead of the whole clock area.
+class ClockRenderer {
+public:
+	enum Hand : uint8_t { Hour, Minute, Second, handsCount };
+
+protected:
+	const AnalogClock* clock = nullptr; // null if the page has no clock
+	uint8_t positions[handsCount]; // as drawn, in 1/60 of full turn
+	uint8_t previous[handsCount]; // before last move
+	bool drawn; // false if hands were not drawn since reset (nothing to erase)
+
+	uint8_t length(Hand hand) const;
+	uint16_t color(Hand hand) const;
+
+	/// \brief Calls the callback with each pixel of the hand at given position,
+	/// along with its coverage (0-255, always 255 if not anti-aliased).
+	template <typename Callback>
+	void plot(Hand hand, uint8_t position, Callback callback) const;
+
+	/// Calls the callback with each pixel of all hands at given positions, in drawing order.
+	template <typename Callback>
+	void plotAll(const uint8_t* positions, Callback callback) const;
+
+	/// Returns area covered by hands at given positions.
+	Rect bounds(const uint8_t* positions) const;
+
+public:
+	/// Resets the renderer for the clock of the page (possibly disabled).
+	void reset(const AnalogClock& clock);
+
+	inline bool isEnabled() const { return clock != nullptr; }
+
+	/// \brief Updates positions of the hands from the (local) time.
+	/// \return true if the hands moved since drawn
+	bool update(const std::tm& time);
+
+	/// Returns area covered by the hands before last move (empty if not drawn).
+	inline Rect previousBounds() const { return drawn ? bounds(previous) : Rect {}; }
+	/// Returns area covered by the hands at current positions.
+	inline Rect currentBounds() const { return bounds(positions); }
+
+	/// Restores pixels under the hands before last move from the background layer.
+	void erasePrevious(Compositor& compositor) const;
+
+	/// Draws the hands at current positions, clipped to the area.
+	void draw(Compositor& compositor, const Rect& clip) const;
+
+	/// Draws the hands at current positions outside damaged areas (where they are drawn when composing).
+	void drawOutside(Compositor& compositor, const Damage& damage) const;
+
+	/// \brief Pushes pixels touched by last move (under previous and current
+	/// hands) to the display, marking the hands as drawn.
+	void presentMoved(Compositor& compositor, PxMATRIX& display);
+};
+
+}
@@ -0,0 +1,54 @@
+#include "Damage.hpp"
+
+namespace pages {
+
+void Damage::add(Rect rect) {
+	rect = rect.intersection(bounds);
+	if (rect.isEmpty()) {
+		return;
+	}
+
+	// Merge with any overlapping rectangle, repeat as merged one can grow
+	for (uint8_t i = 0; i < count; ) {
+		if (rects[i].contains(rect)) {
+			return;
+		}
+		if (rects[i].intersects(rect)) {
+			rect = rect.united(rects[i]);
+			rects[i] = rects[--count];
+			i = 0;
+			continue;
+		}
+		i++;
+	}
+
+	if (count == maxRects) {
+		// Merge with one that makes the smallest area increase
+		uint8_t best = 0;
+		int32_t bestIncrease = INT32_MAX;
+		for (uint8_t i = 0; i < count; i++) {
+			const int32_t increase = rects[i].united(rect).area() - rects[i].area();
+			if (increase < bestIncrease) {
+				bestIncrease = increase;
+				best = i;
+			}
+		}
+		rect = rect.united(rects[best]);
+		rects[best] = rects[--count];
+		add(rect); // might overlap others now
+		return;
+	}
+
+	rects[count++] = rect;
+}
+
+bool Damage::intersects(const Rect& rect) const {
+	for (uint8_t i = 0; i < count; i++) {
+		if (rects[i].intersects(rect)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
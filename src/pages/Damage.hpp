@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include "Rect.hpp"
+
+namespace pages {
+
+/// \brief Keeps track of areas of the display that need to be redrawn.
+/// Overlapping rectangles are merged, and if there are too many of them,
+/// the ones closest to each other are merged too.
+class Damage {
+public:
+	static constexpr uint8_t maxRects = 8;
+
+protected:
+	Rect bounds;
+	Rect rects[maxRects];
+	uint8_t count = 0;
+
+public:
+	Damage(const Rect& bounds)
+		: bounds(bounds)
+	{}
+
+	inline void clear() { count = 0; }
+	inline bool isEmpty() const { return count == 0; }
+	inline bool isFull() const { return count == 1 && rects[0] == bounds; }
+
+	/// Marks the area (clipped to the bounds) as damaged.
+	void add(Rect rect);
+
+	/// Marks whole area as damaged.
+	inline void addFull() {
+		rects[0] = bounds;
+		count = 1;
+	}
+
+	/// Checks whenever given area intersects with any damaged area.
+	bool intersects(const Rect& rect) const;
+
+	inline const Rect* begin() const { return rects; }
+	inline const Rect* end() const { return rects + count; }
+};
+
+}
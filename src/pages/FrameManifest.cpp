@@ -0,0 +1,285 @@
+#include "FrameManifest.hpp"
+#include "bitmap.hpp"
+#include <algorithm> // min
+
+namespace pages {
+
+namespace {
+	constexpr uint8_t maxDirectoryFrames = 255;
+
+	constexpr size_t offsetOfFrame(uint8_t frameIndex) {
+		return offsetof(Animation, frames) + frameIndex * sizeof(Animation::Frame);
+	}
+}
+
+namespace {
+	constexpr uint8_t noFrame = UINT8_MAX;
+}
+
+void FrameManifest::reset() {
+	source = Source::None;
+	count = 0;
+	file.close();
+	delete[] pixels;
+	pixels = nullptr;
+	pixelsFrameIndex = noFrame;
+}
+
+bool FrameManifest::build(const char* basePath) {
+	LOG_TRACE(Pages, "FrameManifest::build(\"%s\")", basePath);
+	reset();
+
+	File file = LittleFS.open(basePath, "r");
+	if (!file) {
+		LOG_DEBUG(Pages, "Failed to open base path '%s'", basePath);
+		return false;
+	}
+	if (file.isFile()) {
+		uint16_t signature;
+		file.read(reinterpret_cast<uint8_t*>(&signature), sizeof(signature));
+		switch (signature) {
+			case BMP::expectedSignature:
+				// Single frame, even if there are other (even numbered) BMP 
+				// files in the same directory.
+				source = Source::Bitmap;
+				count = 1;
+				return true;
+			case Animation::expectedSignature: {
+				Animation::Frame frame;
+				for (; count < Animation::maxFrames; count++) {
+					if (file.read(reinterpret_cast<uint8_t*>(&frame), sizeof(frame)) != sizeof(frame)) {
+						break;
+					}
+					if (!frame.path[0]) {
+						break;
+					}
+					durations[count] = frame.duration;
+				}
+				if (count == 0) {
+					LOG_ERROR(Pages, "Empty animation");
+					return false;
+				}
+				source = Source::Animation;
+				return true;
+			}
+			case Packed::expectedSignature:
+				file.seek(0, SeekSet);
+				if (!Packed::readHeader(file, packed)) {
+					LOG_ERROR(Pages, "Invalid packed animation");
+					return false;
+				}
+				count = std::min<uint16_t>(packed.frameCount, UINT8_MAX - 1);
+				if (packed.flags & Packed::Header::hasDeltaFrames) {
+					const size_t length = static_cast<size_t>(packed.width) * packed.height;
+					pixels = new (std::nothrow) uint16_t[length];
+					if (!pixels) [[unlikely]] {
+						LOG_ERROR(Pages, "Failed to allocate %u bytes for working frame", static_cast<unsigned>(length * sizeof(uint16_t)));
+						return false;
+					}
+				}
+				source = Source::Packed;
+				this->file = file; // keep open
+				return true;
+			default:
+				LOG_ERROR(Pages, "Invalid signature");
+				return false;
+		}
+	}
+	else /* directory */ {
+		char path[32];
+		for (; count < maxDirectoryFrames; count++) {
+			snprintf(path, sizeof(path), "%s/%u.bmp", basePath, count);
+			if (!LittleFS.exists(path)) {
+				break;
+			}
+		}
+		if (count == 0) {
+			LOG_ERROR(Pages, "No frames in '%s'", basePath);
+			return false;
+		}
+		source = Source::Directory;
+		return true;
+	}
+}
+
+uint16_t FrameManifest::duration(uint8_t frameIndex) {
+	if (frameIndex >= count) [[unlikely]] {
+		return 0;
+	}
+	switch (source) {
+		case Source::Animation:
+			return durations[frameIndex];
+		case Source::Packed: {
+			Packed::FrameEntry entry;
+			if (!file.seek(Packed::offsetOfFrameEntry(frameIndex), SeekSet) ||
+				file.read(reinterpret_cast<uint8_t*>(&entry), sizeof(entry)) != sizeof(entry)
+			) [[unlikely]] {
+				return 0;
+			}
+			return entry.duration;
+		}
+		default:
+			return 0;
+	}
+}
+
+bool FrameManifest::seekWorkingFrame(uint8_t frameIndex, Damage* damage, int16_t x, int16_t y) {
+	if (!pixels || frameIndex >= count) [[unlikely]] {
+		return false;
+	}
+	if (pixelsFrameIndex == frameIndex) {
+		return true;
+	}
+
+	// Find where to start from: current frame if the next one is requested,
+	// or the closest keyframe otherwise.
+	Packed::FrameEntry entry;
+	uint8_t start = frameIndex;
+	if (pixelsFrameIndex == noFrame || pixelsFrameIndex + 1 != frameIndex) {
+		for (;; start--) {
+			if (!Packed::seekFrame(file, packed, start, entry)) {
+				return false;
+			}
+			if (!(entry.flags & Packed::FrameEntry::isDelta)) {
+				break;
+			}
+			if (start == 0) [[unlikely]] {
+				LOG_ERROR(Pages, "No keyframe in packed animation");
+				return false;
+			}
+		}
+	}
+
+	pixelsFrameIndex = noFrame; // in case of failure
+	bool whole = start != frameIndex; // if more than single delta, whole frame is considered changed
+	for (uint8_t i = start; i <= frameIndex; i++) {
+		if (!Packed::seekFrame(file, packed, i, entry)) {
+			return false;
+		}
+		if (entry.flags & Packed::FrameEntry::isDelta) {
+			const bool success = Packed::applyDelta(file, packed, pixels, [&](const Rect& rect) {
+				if (damage && !whole) {
+					damage->add(Rect::fromSize(x + rect.x0, y + rect.y0, rect.width(), rect.height()));
+				}
+			});
+			if (!success) {
+				return false;
+			}
+		}
+		else {
+			if (!Packed::readPixels(file, packed, pixels)) {
+				return false;
+			}
+			whole = true;
+		}
+	}
+	if (damage && whole) {
+		damage->add(Rect::fromSize(x, y, packed.width, packed.height));
+	}
+	pixelsFrameIndex = frameIndex;
+	return true;
+}
+
+const AssetCache::Entry* FrameManifest::load(const char* basePath, uint8_t frameIndex, BMP::axis_index_t& width, BMP::axis_index_t& height) {
+	if (isDelta()) {
+		// Not cached, as frames depend on previous ones; see `seekWorkingFrame`
+		width = packed.width;
+		height = packed.height;
+		return nullptr;
+	}
+
+	width = height = 0;
+	if (const AssetCache::Entry* entry = assetCache.find(basePath, frameIndex)) {
+		width = entry->width;
+		height = entry->height;
+		return entry;
+	}
+
+	if (source == Source::Packed) {
+		Packed::FrameEntry entry;
+		if (!Packed::seekFrame(file, packed, frameIndex, entry)) {
+			return nullptr;
+		}
+		width = packed.width;
+		height = packed.height;
+		return assetCache.insert(basePath, frameIndex, file, packed);
+	}
+
+	File file = openBitmap(basePath, frameIndex);
+	if (!file) {
+		return nullptr;
+	}
+	BMP::Headers headers;
+	if (!BMP::readHeaders(file, headers)) {
+		return nullptr;
+	}
+	width = headers.width();
+	height = headers.height();
+	return assetCache.insert(basePath, frameIndex, file, headers);
+}
+
+bool FrameManifest::draw(const char* basePath, uint8_t frameIndex, const Surface& target, int16_t x, int16_t y, uint16_t transparentColor, const Rect& clip) {
+	if (isDelta()) {
+		if (!seekWorkingFrame(frameIndex, nullptr, x, y)) {
+			return false;
+		}
+		BMP::draw(target, pixels, packed.width, packed.height, x, y, transparentColor, clip);
+		return true;
+	}
+	if (source == Source::Packed) {
+		Packed::FrameEntry entry;
+		if (!Packed::seekFrame(file, packed, frameIndex, entry)) {
+			return false;
+		}
+		return Packed::draw(target, file, packed, x, y, transparentColor, clip);
+	}
+
+	File file = openBitmap(basePath, frameIndex);
+	if (!file) {
+		return false;
+	}
+	BMP::Headers headers;
+	if (!BMP::readHeaders(file, headers)) {
+		return false;
+	}
+	return BMP::draw(target, file, headers, x, y, transparentColor, clip);
+}
+
+File FrameManifest::openBitmap(const char* basePath, uint8_t frameIndex) const {
+	LOG_TRACE(Pages, "FrameManifest::openBitmap(\"%s\", %u)", basePath, frameIndex);
+	if (frameIndex >= count) [[unlikely]] {
+		return File(); // so it evaluates to false on boolean operator
+	}
+
+	char path[32];
+	switch (source) {
+		case Source::None:
+		case Source::Packed:
+			return File();
+		case Source::Bitmap:
+			return LittleFS.open(basePath, "r");
+		case Source::Directory:
+			snprintf(path, sizeof(path), "%s/%u.bmp", basePath, frameIndex);
+			break;
+		case Source::Animation: {
+			// Read only the path of the frame, instead whole struct
+			File file = LittleFS.open(basePath, "r");
+			if (!file || !file.seek(offsetOfFrame(frameIndex), SeekSet)) {
+				return File();
+			}
+			constexpr size_t length = sizeof(Animation::Frame::path);
+			static_assert(length < sizeof(path));
+			file.read(reinterpret_cast<uint8_t*>(path), length);
+			path[length] = 0;
+			break;
+		}
+	}
+
+	File file = LittleFS.open(path, "r");
+	if (!file) {
+		LOG_DEBUG(Pages, "Failed to open '%s'", path);
+	}
+	return file;
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "common.hpp"
+#include <LittleFS.h>
+#include "Animation.hpp"
+#include "AssetCache.hpp"
+#include "packed.hpp"
+#include "Damage.hpp"
+
+namespace pages {
+
+/// \brief Frames of the asset, resolved once (when the asset path is set 
+/// or changes), so advancing the frame is just incrementing the index,
+/// without probing the file system. Frames can be provided by single BMP 
+/// file, directory of numbered BMP files (`0.bmp`, `1.bmp`, ...),
+/// `Animation` struct file pointing to BMP files, or packed animation
+/// container (kept open, so switching frames is just seeking). Delta encoded
+/// packed animations are decoded into working frame instead the cache,
+/// as their frames depend on previous ones.
+struct FrameManifest {
+	enum class Source : uint8_t {
+		None, // not resolved or failed
+		Bitmap,
+		Directory,
+		Animation,
+		Packed,
+	};
+
+	Source source;
+	uint8_t count;
+	uint16_t durations[Animation::maxFrames]; // ms, only for animation file, 0 if not specified
+	File file; // only for packed container
+	Packed::Header packed; // only for packed container
+	uint16_t* pixels; // working frame, only for delta encoded packed container
+	uint8_t pixelsFrameIndex; // frame currently in the working frame
+
+	/// Forgets resolved frames, closing the file if any.
+	void reset();
+
+	/// \brief Resolves frames for the base path.
+	/// \param basePath path (with variables already substituted) to BMP 
+	/// file, directory, `Animation` struct file or packed animation container.
+	/// \return true on success, false otherwise
+	bool build(const char* basePath);
+
+	inline bool isDelta() const {
+		return source == Source::Packed && (packed.flags & Packed::Header::hasDeltaFrames);
+	}
+
+	/// \brief Brings working frame to given frame (for delta encoded packed 
+	/// container), applying the delta if it's the next frame, or decoding
+	/// from the last keyframe otherwise.
+	/// \param damage If not null, changed areas of the frame (placed at x & y) 
+	/// are marked as damaged.
+	/// \return true on success, false otherwise
+	bool seekWorkingFrame(uint8_t frameIndex, Damage* damage, int16_t x, int16_t y);
+
+	/// Returns frame duration specified by the asset itself, or 0 if none.
+	uint16_t duration(uint8_t frameIndex);
+
+	/// \brief Finds the frame in decoded frames cache, decoding it if necessary.
+	/// \param width (output) width of the frame, set even if it can't be cached
+	/// \param height (output) height of the frame, set even if it can't be cached
+	/// \return Cached entry, or null pointer if the frame could not be cached.
+	const AssetCache::Entry* load(const char* basePath, uint8_t frameIndex, BMP::axis_index_t& width, BMP::axis_index_t& height);
+
+	/// \brief Draws the frame directly from file, for frames that can't be cached.
+	/// \return true on success, false otherwise
+	bool draw(const char* basePath, uint8_t frameIndex, const Surface& target, int16_t x, int16_t y, uint16_t transparentColor, const Rect& clip);
+
+protected:
+	/// \brief Opens BMP file for given frame (for sources other than packed).
+	/// \return File for the frame, should fail when cast to boolean on error.
+	File openBitmap(const char* basePath, uint8_t frameIndex) const;
+};
+
+}
@@ -1,5 +1,6 @@
 #include "Page.hpp"
 #include "common.hpp"
+#include "RenderPlan.hpp"
 #include <LittleFS.h>
 
 namespace pages { 
@@ -10,17 +11,21 @@ void Page::loadById(uint8_t id) {
 	load(path);
 }
 void Page::load(const char* path) {
+	read(path);
+	renderPlan.compile(*this);
+}
+bool Page::read(const char* path) {
 	File file = LittleFS.open(path, "r");
 	if (!file || !file.isFile()) {
 		LOG_ERROR(Pages, "Failed to open '%s' as page config", path);
-		return;
+		return false;
 	}
 
 	if (CHECK_LOG_LEVEL(Pages, LEVEL_DEBUG)) {
-		LOG_DEBUG(Pages, "file size=%u", file.size());
+		LOG_DEBUG(Pages, "file size=%u", static_cast<unsigned>(file.size()));
 	}
 
-	int i = file.read(reinterpret_cast<uint8_t*>(this), sizeof(Page));
+	[[maybe_unused]] int i = file.read(reinterpret_cast<uint8_t*>(this), sizeof(Page));
 	LOG_DEBUG(Pages, "Loading page from '%s', read %u bytes", path, i);
 	if (this->signature != Page::expectedSignature) {
 		LOG_ERROR(Pages, "Invalid signature");
@@ -38,7 +43,7 @@ void Page::load(const char* path) {
 		for (uint8_t i = 0; i < Page::maxSprites; i++) {
 			const auto& sprite = this->sprites[i];
 			LOG_DEBUG(Pages, "sprite %u. type=%u x=%u y=%u", 
-				i, sprite.common.type, sprite.common.x, sprite.common.y);
+				i, static_cast<unsigned>(sprite.common.type), sprite.common.x, sprite.common.y);
 
 			switch (sprite.common.type) {
 				case Sprite::Type::None:
@@ -57,7 +62,7 @@ void Page::load(const char* path) {
 				case Sprite::Type::Temperature: {
 					LOG_DEBUG(Pages, "\tfont=%u dot=%u degree=%u pad=%u source=%u future=%u prec=%u unit=%u", 
 						sprite.temperature.font, sprite.temperature.dotSize, sprite.temperature.degreeSize, 
-						sprite.temperature.padLeft, sprite.temperature.source, sprite.temperature.inFuture,
+						sprite.temperature.padLeft, static_cast<unsigned>(sprite.temperature.source), sprite.temperature.inFuture,
 						sprite.temperature.precision, sprite.temperature.unit);
 					// TODO: ref value/target colors
 					break;
@@ -76,8 +81,14 @@ void Page::load(const char* path) {
 			}
 		}
 
-		// TODO: analog clock info
+		if (this->analog.isEnabled()) {
+			LOG_DEBUG(Pages, "analog x=%u y=%u lengths=%u/%u/%u antialiased=%u",
+				this->analog.centerX, this->analog.centerY, this->analog.hourArrowLength,
+				this->analog.minuteArrowLength, this->analog.secondArrowLength, this->analog.antialiased);
+		}
 	}
+
+	return true;
 }
 
 }
@@ -37,8 +37,14 @@ struct Page {
 	static constexpr size_t maxSprites = 9;
 	Sprite sprites[maxSprites];
 
+	/// Loads page of given ID/number, see `load`.
 	void loadById(uint8_t id);
+	/// Loads page from the file, and compiles the render plan for it. 
+	/// If loading fails, the plan is compiled for current page contents.
 	void load(const char* path);
+
+protected:
+	bool read(const char* path);
 };
 constexpr auto _sizeof_Page = sizeof(Page);
 static_assert(sizeof(Page) <= 256);
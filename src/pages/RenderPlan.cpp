@@ -0,0 +1,121 @@
+#include "RenderPlan.hpp"
+#include "Renderer.hpp" // fontById
+
+namespace pages {
+
+void AssetState::setPath(const char* path) {
+	rawPath = path;
+	hasVariables = std::strchr(path, '$') != nullptr;
+	loaded = false;
+	std::memset(basePath, 0, sizeof(basePath));
+	frames.reset();
+	frameIndex = 0;
+	frameDuration = 0;
+	currentDuration = 0;
+	lastFrameChange = 0;
+	width = height = 0;
+	if (!hasVariables) {
+		std::strncpy(basePath, path, sizeof(basePath) - 1);
+		frames.build(basePath);
+	}
+}
+
+bool TimeState::isBlinking(uint8_t index) const {
+	if (!sprite->blinkColon || cells[index].character != ':') {
+		return false;
+	}
+	if (sprite->bothColons) {
+		return true;
+	}
+	for (uint8_t i = index + 1; i < count; i++) {
+		if (cells[i].character == ':') {
+			return false; // not the last one
+		}
+	}
+	return true;
+}
+
+void RenderPlan::compile(const Page& page) {
+	backgroundFromFile = page.usesBackgroundFromFile();
+	if (backgroundFromFile) {
+		background.setPath(page.backgroundPath);
+		background.frameDuration = page.backgroundDuration;
+	}
+	else {
+		backgroundColor = page.backgroundColors.primary;
+		background.frames.reset(); // close files kept open for previous page
+	}
+	for (auto& asset : assets) {
+		asset.frames.reset();
+	}
+
+	count = 0;
+	gradientPoolUsed = 0;
+	for (uint8_t i = 0; i < Page::maxSprites; i++) {
+		const auto& sprite = page.sprites[i];
+		if (sprite.common.type == Sprite::Type::None) {
+			continue;
+		}
+
+		DrawOp& op = ops[count++];
+		std::memset(&op, 0, sizeof(DrawOp));
+		op.spriteIndex = i;
+		op.x = sprite.common.x;
+		op.y = sprite.common.y;
+
+		switch (sprite.common.type) {
+			case Sprite::Type::None:
+				break;
+			case Sprite::Type::Text:
+				op.kind = DrawOp::Kind::Text;
+				op.font = fontById(sprite.text.font);
+				op.color = sprite.text.color;
+				std::strncpy(op.text, sprite.text.text, sizeof(Sprite::Text::text));
+				op.text[sizeof(Sprite::Text::text) - 1] = 0;
+				break;
+			case Sprite::Type::Time:
+				op.kind = DrawOp::Kind::Time;
+				op.font = fontById(sprite.time.font);
+				op.color = sprite.time.color;
+				op.time = &times[i];
+				*op.time = {};
+				op.time->sprite = &sprite.time;
+				op.time->format.compile(sprite.time.format);
+				op.time->colonsVisible = true;
+				break;
+			case Sprite::Type::Temperature:
+				op.kind = DrawOp::Kind::Temperature;
+				op.font = fontById(sprite.temperature.font);
+				op.temperature = &temperatures[i];
+				op.temperature->sprite = &sprite.temperature;
+				gradientPoolUsed += op.temperature->gradient.bake(
+					sprite.temperature.referenceValue[0], 
+					sprite.temperature.referenceValue[2],
+					gradientPool + gradientPoolUsed, 
+					gradientPoolSize - gradientPoolUsed,
+					[&](float value) { return sprite.temperature.interpolateColor(value); }
+				);
+				break;
+			case Sprite::Type::Image:
+				op.kind = DrawOp::Kind::Image;
+				op.color = sprite.image.transparentColor;
+				op.asset = &assets[i];
+				op.asset->setPath(sprite.image.path);
+				op.asset->frameDuration = sprite.image.frameDuration;
+				break;
+			case Sprite::Type::CustomChar:
+				op.kind = DrawOp::Kind::CustomChar;
+				op.color = sprite.customChar.color;
+				op.customChar = &sprite.customChar;
+				break;
+		}
+	}
+
+	clock.reset(page.analog);
+
+	LOG_DEBUG(Pages, "Compiled render plan with %u ops", count);
+}
+
+RenderPlan renderPlan;
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "common.hpp"
+#include <Adafruit_GFX.h> // GFXfont
+#include "Rect.hpp"
+#include "bitmap.hpp"
+#include "Page.hpp"
+#include "FrameManifest.hpp"
+#include "GlyphAtlas.hpp"
+#include "TimeFormat.hpp"
+#include "ClockRenderer.hpp"
+#include "ColorGradient.hpp"
+
+namespace pages {
+
+/// State of asset (background or image sprite) displayed by pages system.
+struct AssetState {
+	const char* rawPath; // as in page config, can contain path variables
+	bool hasVariables; // if false, base path is resolved once, at compile time
+	bool loaded; // false if frame needs to be selected from scratch
+	char basePath[24]; // with path variables substituted
+	FrameManifest frames; // resolved for the base path
+	uint8_t frameIndex;
+	uint16_t frameDuration; // default, if not specified by the frame; >0 ms for animation, or 0 for still image
+	uint16_t currentDuration; // of current frame, or 0 if it should stay
+	millis_t lastFrameChange;
+	BMP::axis_index_t width;
+	BMP::axis_index_t height;
+
+	void setPath(const char* path);
+
+};
+
+/// \brief State of time sprite, keeping characters as laid out when last 
+/// drawn, so only cells that changed (usually last digit) are redrawn.
+struct TimeState {
+	static constexpr uint8_t maxCells = 24; // as formatted text
+
+	const Sprite::Time* sprite;
+	TimeFormat format; // compiled from the sprite format
+	bool colonsVisible;
+	uint8_t count;
+	GlyphAtlas::Cell cells[maxCells];
+
+	/// Checks whenever the colon at given cell should blink.
+	bool isBlinking(uint8_t index) const;
+};
+
+/// State of temperature sprite, with color gradient baked for its references.
+struct TemperatureState {
+	const Sprite::Temperature* sprite;
+	ColorGradient gradient; // in render plan pool
+};
+
+/// \brief Single drawing operation of the render plan, with fonts, colors
+/// and assets resolved when compiling the plan, along with state of what
+/// was drawn last time (to detect changes).
+struct DrawOp {
+	enum class Kind : uint8_t {
+		Text,
+		Time,
+		Temperature,
+		Image,
+		CustomChar,
+	};
+
+	Kind kind;
+	uint8_t spriteIndex; // for debugging
+	bool valid; // false if needs to be updated from scratch
+	bool redraw; // true if needs to be drawn in current update
+	int16_t x;
+	int16_t y;
+	uint16_t color; // text color, or transparent color for images
+	const GFXfont* font;
+	Rect bounds; // area covered as last drawn
+
+	union {
+		TimeState* time;
+		TemperatureState* temperature;
+		const Sprite::CustomChar* customChar;
+		AssetState* asset;
+	};
+
+	char text[24]; // text to be drawn (copied, or formatted for time & temperature)
+};
+
+/// \brief Compact render plan for the page, compiled when the page is loaded,
+/// so per-frame rendering only runs flat array of resolved draw operations.
+/// Operations point into the page they were compiled from.
+struct RenderPlan {
+	static constexpr uint8_t maxOps = Page::maxSprites;
+
+	bool backgroundFromFile;
+	uint16_t backgroundColor;
+	AssetState background;
+	AssetState assets[Page::maxSprites];
+	TimeState times[Page::maxSprites];
+	TemperatureState temperatures[Page::maxSprites];
+
+	/// Pool for color gradients (temperature sprites), as RGB565 colors.
+	static constexpr uint16_t gradientPoolSize = 512;
+	uint16_t gradientPool[gradientPoolSize];
+	uint16_t gradientPoolUsed;
+
+	uint8_t count;
+	DrawOp ops[maxOps];
+
+	ClockRenderer clock; // drawn over the sprites
+
+	void compile(const Page& page);
+
+	inline DrawOp* begin() { return ops; }
+	inline DrawOp* end() { return ops + count; }
+};
+
+extern RenderPlan renderPlan;
+
+}
@@ -0,0 +1,543 @@
+#include "Renderer.hpp"
+#include "Animation.hpp"
+#include "Damage.hpp"
+#include "AssetCache.hpp"
+#include "Compositor.hpp"
+#include "GlyphAtlas.hpp"
+#include "Metrics.hpp"
+#include "TimeService.hpp"
+#include <Fonts/FreeSerifBold12pt7b.h>
+
+extern PxMATRIX display; // from main
+extern Compositor compositor; // from main
+extern float temperature; // from main
+
+namespace pages {
+
+const GFXfont* fontById(uint8_t font) {
+	switch (font) {
+		// case 1:  return &FreeMono9pt7b;
+		// case 2:  return &FreeMono12pt7b;
+		// case 3:  return &FreeMonoBold9pt7b;
+		// case 4:  return &FreeMonoBold12pt7b;
+		// case 5:  return &FreeSans9pt7b;
+		// case 6:  return &FreeSans12pt7b;
+		// case 7:  return &FreeSansBold9pt7b;
+		// case 8:  return &FreeSansBold12pt7b;
+		// case 9:  return &FreeSerif9pt7b;
+		// case 10: return &FreeSerif12pt7b;
+		// case 11: return &FreeSerifBold9pt7b;
+		case 12: return &FreeSerifBold12pt7b;
+		// case 13: return &Picopixel
+		// case 14: return &Org_01
+		// case 15: return &TomThumb
+		default: return nullptr; // default 6x8 font will be used
+	}
+}
+
+
+/// Currently displayed page for pages system.
+/// Initialized with predefined stuff to display in case filesystem failure.
+Page activePage = {
+	.duration = 0, // single page
+	.backgroundColors = {
+		.flag = 0,
+		.primary = colors::to565(colors::white),
+	},
+	.backgroundDuration = 0, // still frame
+	.analog = { .centerX = 255, }, // disabled
+	.sprites = {
+		{ .text = { /*.text = "FS FAIL?",*/ .x = 4, .y = 4, } },
+	}
+};
+millis_t lastPageChange;
+uint8_t activePageId; // for metrics
+
+/// Areas of the display to be redrawn on next update.
+Damage damage(Rect::fromSize(0, 0, MATRIX_WIDTH, MATRIX_HEIGHT));
+
+void changeActivePage(uint8_t id) {
+	activePage.loadById(id); // compiles the render plan too
+	activePageId = id;
+	lastPageChange = millis();
+
+	// Invalidate everything drawn for previous page
+	if (not renderPlan.backgroundFromFile) {
+		compositor.fillBackground(renderPlan.backgroundColor);
+	}
+	damage.addFull();
+}
+
+void reloadActivePage() {
+	const millis_t pageChange = lastPageChange;
+	changeActivePage(activePageId);
+	lastPageChange = pageChange;
+}
+
+Scheduler::Task* reloadTask = nullptr;
+
+void scheduleReload() {
+	if (reloadTask) {
+		scheduler.runIn(reloadTask, 0);
+	}
+	else {
+		reloadActivePage();
+	}
+}
+
+/// True if path variables might have changed since assets were last updated.
+bool pathVariablesChanged = true;
+
+void setup() {
+	TimeService::subscribe(TimeService::Months | TimeService::Seasons, [](const TimeService::Snapshot&, uint8_t) {
+		pathVariablesChanged = true;
+	});
+}
+
+void substitutePathVariables(char* output, const char* raw) {
+	const auto& now = TimeService::now();
+	for (const char* fp = raw; *fp; fp++) {
+		if (*fp == '$') {
+			fp++;
+			switch (*fp) {
+				case 'M': /* month*/ {
+					const char* vp = now.monthName();
+					*output++ = *vp++ + ('a' - 'A');
+					while (*vp) *output++ = *vp++;
+					break;
+				}
+				case 'S': /* season */ {
+					const char* vp = now.seasonName();
+					while (*vp) *output++ = *vp++;
+					break;
+				}
+				case 'W': /* weather */ {
+					// TODO: weather (also consider how to express future weather)
+					const char* vp = "sunny";
+					while (*vp) *output++ = *vp++;
+					break;
+				}
+				default:
+					*output++ = *fp;
+					LOG_WARN(Pages, "Unknown path variable $%c", *fp);
+					break; // will fail to find the file most likely
+			}
+		}
+		else {
+			*output++ = *fp;
+		}
+	}
+	*output = 0;
+	// TODO: improve safety?
+}
+
+/// Kind of change of the asset, as result of its update.
+enum class AssetChange : uint8_t {
+	None,
+	Partial, // only some areas changed, already marked as damaged
+	Full,
+};
+
+/// \brief Updates state of the asset: substitutes path variables (if any, and
+/// only when they could change), resolving frames again if the path changed, and advances the frame if its 
+/// duration passed. Selected frame is put into decoded frames cache (if possible),
+/// so drawing it later avoids the file system.
+/// \param asset State of the asset to be updated.
+/// \param x horizontal position of the asset, for marking damaged areas
+/// \param y vertical position of the asset, for marking damaged areas
+/// \return Kind of change: partial for delta encoded frames (changed areas 
+/// already marked as damaged), full if whole other frame is to be displayed.
+AssetChange updateAsset(AssetState& asset, millis_t currentMillis, int16_t x, int16_t y) {
+	bool changed = !asset.loaded;
+	if (asset.hasVariables && (changed || pathVariablesChanged)) {
+		char basePath[sizeof(AssetState::basePath)];
+		substitutePathVariables(basePath, asset.rawPath);
+		if (changed || std::strcmp(basePath, asset.basePath) != 0) {
+			std::strcpy(asset.basePath, basePath);
+			asset.frames.build(asset.basePath);
+			changed = true;
+		}
+	}
+	if (changed) {
+		asset.frameIndex = 0;
+	}
+	else {
+		if (asset.currentDuration == 0) {
+			return AssetChange::None;
+		}
+		const auto durationFromLast = static_cast<uint16_t>(currentMillis - asset.lastFrameChange);
+		if (durationFromLast < asset.currentDuration) {
+			return AssetChange::None;
+		}
+		if (++asset.frameIndex >= asset.frames.count) {
+			asset.frameIndex = 0;
+		}
+	}
+	asset.loaded = true;
+	asset.lastFrameChange = currentMillis;
+	asset.currentDuration = 0;
+	if (asset.frames.count > 1) {
+		const uint16_t duration = asset.frames.duration(asset.frameIndex);
+		asset.currentDuration = duration ? duration : asset.frameDuration;
+	}
+
+	// Delta encoded frames are applied onto working frame right away,
+	// marking only areas that changed (unless whole asset is new).
+	if (asset.frames.isDelta()) {
+		asset.width = asset.frames.packed.width;
+		asset.height = asset.frames.packed.height;
+		if (!asset.frames.seekWorkingFrame(asset.frameIndex, changed ? nullptr : &damage, x, y)) {
+			asset.width = asset.height = 0;
+			return AssetChange::Full;
+		}
+		return changed ? AssetChange::Full : AssetChange::Partial;
+	}
+
+	// Decode into the cache already, so drawing it later avoids the file system
+	asset.frames.load(asset.basePath, asset.frameIndex, asset.width, asset.height);
+	return AssetChange::Full;
+}
+
+/// \brief Draws current frame of the asset to the surface, from the decoded 
+/// frames cache if possible, falling back to reading the file.
+/// \param clip Area of the surface to limit drawing to.
+/// \return true on success, false otherwise
+bool drawAsset(
+	AssetState& asset, const Surface& target, 
+	int16_t x, int16_t y, uint16_t transparentColor, const Rect& clip
+) {
+	if (!asset.width) {
+		return false;
+	}
+	BMP::axis_index_t width, height;
+	if (auto entry = asset.frames.load(asset.basePath, asset.frameIndex, width, height)) {
+		if (entry->alpha) {
+			BMP::draw(target, entry->pixels, entry->alpha, entry->width, entry->height, x, y, clip);
+			return true;
+		}
+		if (transparentColor) {
+			if (auto spans = assetCache.opaqueSpans(entry, transparentColor)) {
+				BMP::draw(target, entry->pixels, spans, entry->width, entry->height, x, y, clip);
+				return true;
+			}
+		}
+		BMP::draw(target, entry->pixels, entry->width, entry->height, x, y, transparentColor, clip);
+		return true;
+	}
+	return asset.frames.draw(asset.basePath, asset.frameIndex, target, x, y, transparentColor, clip);
+}
+
+/// Returns area covered by the text printed using given font at given position.
+Rect getTextBounds(const GFXfont* font, const char* text, int16_t x, int16_t y) {
+	return glyphAtlas.bounds(font, text, x, y, compositor.width());
+}
+
+/// \brief Updates time sprite: formats the time (only when fields used by
+/// the format could change) and lays the text out into cells, marking as damaged only cells that changed (usually the last digit)
+/// or colons that blinked, so drawing only them is enough.
+/// \return true if anything changed and needs to be redrawn
+bool updateTime(DrawOp& op, millis_t currentMillis) {
+	TimeState& state = *op.time;
+	const Sprite::Time& sprite = *state.sprite;
+
+	const auto& now = TimeService::now();
+	bool colonsVisible = true;
+	if (sprite.blinkColon) {
+		colonsVisible = sprite.blinkSlow
+			? now.time % 2 == 0
+			: currentMillis - now.secondStart < 500;
+	}
+
+	// Format only if any field used by the format could change
+	bool textChanged = false;
+	char buffer[sizeof(DrawOp::text)];
+	if (!op.valid || state.format.isDue(now.time)) {
+		state.format.format(buffer, sizeof(buffer), now.time, sprite.useUTC ? now.utc : now.local);
+		textChanged = !op.valid || std::strcmp(buffer, op.text) != 0;
+	}
+	const bool blinked = colonsVisible != state.colonsVisible;
+	if (!textChanged && !blinked) {
+		return false;
+	}
+
+	GlyphAtlas::Cell previous[TimeState::maxCells];
+	const uint8_t previousCount = op.valid ? state.count : 0;
+	std::memcpy(previous, state.cells, sizeof(previous));
+	if (textChanged) {
+		std::strcpy(op.text, buffer);
+		state.count = glyphAtlas.layout(
+			op.font, op.text, op.x, op.y, compositor.width(), state.cells, TimeState::maxCells, 
+			{ sprite.colonWidthStart, sprite.colonMinusAdvanceX }
+		);
+	}
+	state.colonsVisible = colonsVisible;
+
+	// Damage cells that differ, and toggled colons
+	Rect bounds = Rect::fromSize(op.x, op.y, 0, 0);
+	const uint8_t count = std::max(previousCount, state.count);
+	for (uint8_t i = 0; i < count; i++) {
+		const GlyphAtlas::Cell& before = previous[i];
+		const GlyphAtlas::Cell& after = state.cells[i];
+		const bool wasDrawn = i < previousCount;
+		const bool isDrawn = i < state.count;
+		bool same = wasDrawn && isDrawn 
+			&& before.character == after.character && before.x == after.x && before.y == after.y;
+		if (same && blinked && state.isBlinking(i)) {
+			same = false;
+		}
+		if (!same) {
+			if (wasDrawn) damage.add(glyphAtlas.bounds(op.font, before));
+			if (isDrawn)  damage.add(glyphAtlas.bounds(op.font, after));
+		}
+		if (isDrawn) {
+			bounds = bounds.united(glyphAtlas.bounds(op.font, after));
+		}
+	}
+	op.bounds = bounds;
+	op.valid = true;
+	return true;
+}
+
+/// \brief Updates the draw operation, i.e. formats time or temperature text.
+/// Marks areas covered before and after the change as damaged.
+/// \return true if the operation result changed and needs to be redrawn
+bool update(DrawOp& op, millis_t currentMillis) {
+	bool changed = !op.valid;
+	Rect bounds = op.bounds;
+
+	switch (op.kind) {
+		case DrawOp::Kind::Text:
+			if (changed) {
+				bounds = getTextBounds(op.font, op.text, op.x, op.y);
+			}
+			break;
+		case DrawOp::Kind::Time:
+			return updateTime(op, currentMillis);
+		case DrawOp::Kind::Temperature: {
+			char buffer[sizeof(DrawOp::text)];
+			const TemperatureState& state = *op.temperature;
+			snprintf(buffer, sizeof(buffer), "%.*f", state.sprite->precision, temperature);
+			// TODO: other temperature sources
+
+			if (changed || std::strcmp(buffer, op.text) != 0) {
+				std::strcpy(op.text, buffer);
+				op.color = state.gradient.isBaked() 
+					? state.gradient.at(temperature)
+					: state.sprite->interpolateColor(temperature);
+				bounds = getTextBounds(op.font, op.text, op.x, op.y);
+				changed = true;
+			}
+			break;
+		}
+		case DrawOp::Kind::Image: {
+			const AssetChange change = updateAsset(*op.asset, currentMillis, op.x, op.y);
+			if (change == AssetChange::Partial && !changed) {
+				return true; // changed areas already damaged, and images are drawn clipped to them
+			}
+			if (change == AssetChange::Full || changed) {
+				bounds = Rect::fromSize(op.x, op.y, op.asset->width, op.asset->height);
+				changed = true;
+			}
+			break;
+		}
+		case DrawOp::Kind::CustomChar:
+			if (changed) {
+				bounds = Rect::fromSize(op.x, op.y, op.customChar->width, op.customChar->height());
+			}
+			break;
+	}
+
+	if (changed) {
+		damage.add(op.bounds);
+		damage.add(bounds);
+		op.bounds = bounds;
+		op.valid = true;
+	}
+	return changed;
+}
+
+/// \brief Draws the operation into the frame being composed. Except custom
+/// characters, operations are drawn only in damaged areas, so they don't need
+/// to be redrawn in whole when something else changed over them.
+void draw(const DrawOp& op) {
+	LOG_TRACE(Pages, "Sprite %u. kind=%u x=%d y=%d", op.spriteIndex, static_cast<unsigned>(op.kind), op.x, op.y);
+
+	if (op.kind == DrawOp::Kind::CustomChar) {
+		auto& canvas = compositor.canvas();
+		const auto& customChar = *op.customChar;
+		const auto xLimit = op.x + customChar.width;
+		const auto yLimit = op.y + customChar.height();
+		uint8_t i = 0;
+		uint8_t mask = 1;
+		for (int16_t y = op.y; y < yLimit; y++) {
+			for (int16_t x = op.x; x < xLimit; x++) {
+				if (customChar.data[i] & mask) {
+					canvas.writePixel(x, y, op.color);
+				}
+				mask <<= 1;
+				if (!mask) {
+					i += 1;
+					mask = 1;
+				}
+			}
+		}
+		return;
+	}
+
+	const Surface target = compositor.frameSurface();
+	for (const Rect& rect : damage) {
+		const Rect clip = rect.intersection(op.bounds);
+		if (clip.isEmpty()) {
+			continue;
+		}
+		switch (op.kind) {
+			case DrawOp::Kind::Text:
+			case DrawOp::Kind::Temperature:
+				glyphAtlas.draw(target, op.font, op.text, op.x, op.y, op.color, compositor.width(), clip);
+				// TODO: dot size, degree size
+				break;
+			case DrawOp::Kind::Time: {
+				const TimeState& state = *op.time;
+				for (uint8_t i = 0; i < state.count; i++) {
+					if (!state.colonsVisible && state.isBlinking(i)) {
+						continue;
+					}
+					glyphAtlas.draw(target, op.font, state.cells[i], op.color, clip);
+				}
+				// TODO: dot size
+				break;
+			}
+			case DrawOp::Kind::Image:
+				if (!drawAsset(*op.asset, target, op.x, op.y, op.color, clip)) {
+					// TODO: error once?
+					LOG_ERROR(Pages, "Failed to select frame");
+					return;
+				}
+				break;
+			case DrawOp::Kind::CustomChar:
+				break; // drawn in whole above
+		}
+	}
+}
+
+void updatePagesStuff() {
+	millis_t currentMillis = millis();
+	const uint32_t startMicros = micros();
+	uint32_t stageStart = startMicros;
+
+	// Going to next pages
+	if (activePage.hasNextPage()) {
+		const auto durationFromLast = static_cast<uint16_t>(currentMillis - lastPageChange);
+		if (durationFromLast >= activePage.duration) {
+			changeActivePage(activePage.next);
+		}
+	}
+
+	// Background
+	if (renderPlan.backgroundFromFile) {
+		const Surface background = compositor.backgroundSurface();
+		switch (updateAsset(renderPlan.background, currentMillis, 0, 0)) {
+			case AssetChange::None:
+				break;
+			case AssetChange::Partial:
+				// Update background layer only where it changed
+				for (const Rect& rect : damage) {
+					drawAsset(renderPlan.background, background, 0, 0, 0, rect);
+				}
+				break;
+			case AssetChange::Full:
+				// Rebuild background layer
+				if (!drawAsset(renderPlan.background, background, 0, 0, 0, background.bounds())) {
+					// TODO: error once?
+					LOG_ERROR(Pages, "Failed to select frame");
+					compositor.fillBackground(0);
+				}
+				damage.addFull();
+				break;
+		}
+	}
+	Metrics::renderStage(Metrics::RenderStage::Background).observeSince(stageStart);
+
+	// Collect areas of changed sprites
+	for (auto& op : renderPlan) {
+		op.redraw = update(op, currentMillis);
+	}
+	pathVariablesChanged = false; // all assets updated
+
+	// Analog clock hands moved: pixels under previous hands are restored from
+	// background right away, except where sprites are (these areas are 
+	// redrawn as damaged), and new hands are pushed along after composing.
+	ClockRenderer& clock = renderPlan.clock;
+	const bool clockMoved = clock.isEnabled() && clock.update(TimeService::now().local);
+	if (clockMoved) {
+		const Rect previousBounds = clock.previousBounds();
+		for (const auto& op : renderPlan) {
+			if (op.bounds.intersects(previousBounds)) {
+				damage.add(op.bounds.intersection(previousBounds));
+			}
+		}
+		clock.erasePrevious(compositor);
+	}
+
+	if (damage.isEmpty() && !clockMoved) {
+		Metrics::renderStage(Metrics::RenderStage::Update).observeSince(stageStart);
+		Metrics::observePage(activePageId, stageStart - startMicros);
+		return;
+	}
+
+	// Sprites overlapping damaged areas need to be redrawn too. Custom 
+	// characters are drawn in whole, which damages whole their areas, 
+	// others are drawn clipped to damaged areas.
+	for (bool grown = true; grown; ) {
+		grown = false;
+		for (auto& op : renderPlan) {
+			if (!op.redraw && !op.bounds.isEmpty() && damage.intersects(op.bounds)) {
+				op.redraw = true;
+				if (op.kind == DrawOp::Kind::CustomChar) {
+					damage.add(op.bounds);
+					grown = true;
+				}
+			}
+		}
+	}
+
+	Metrics::renderStage(Metrics::RenderStage::Update).observeSince(stageStart);
+
+	// Restore background
+	for (const Rect& rect : damage) {
+		LOG_TRACE(Pages, "Damaged x=%d y=%d w=%d h=%d", rect.x0, rect.y0, rect.width(), rect.height());
+		compositor.restore(rect);
+	}
+
+	// Sprites
+	for (const auto& op : renderPlan) {
+		if (op.redraw) {
+			draw(op);
+		}
+	}
+
+	// Analog clock, over the sprites
+	if (clock.isEnabled()) {
+		for (const Rect& rect : damage) {
+			clock.draw(compositor, rect);
+		}
+		if (clockMoved) {
+			clock.drawOutside(compositor, damage);
+		}
+	}
+
+	Metrics::renderStage(Metrics::RenderStage::Compose).observeSince(stageStart);
+
+	// Push finished areas to the display
+	for (const Rect& rect : damage) {
+		compositor.present(display, rect);
+	}
+	if (clockMoved) {
+		clock.presentMoved(compositor, display);
+	}
+	damage.clear();
+	Metrics::renderStage(Metrics::RenderStage::Present).observeSince(stageStart);
+	Metrics::observePage(activePageId, stageStart - startMicros);
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common.hpp"
+#include <LittleFS.h>
+#include "Page.hpp"
+#include "RenderPlan.hpp"
+#include "Scheduler.hpp"
+
+namespace pages {
+
+/// Currently displayed page for pages system.
+extern Page activePage;
+
+/// Returns font for given font ID used in sprites config, 
+/// or null pointer for default 6x8 font.
+const GFXfont* fontById(uint8_t font);
+
+/// Subscribes to changes of time, which page assets paths might depend on.
+void setup();
+
+/// Loads and displays page of given ID/number.
+void changeActivePage(uint8_t id);
+
+/// \brief Loads active page again, to be called when its files might have
+/// changed (like uploads), so assets and their frames are resolved again
+/// and the whole display is redrawn. Page keeps its display duration.
+void reloadActivePage();
+
+/// Deadline task reloading active page, registered by main (null if not).
+extern Scheduler::Task* reloadTask;
+
+/// \brief Reloads active page on next scheduler pass, so files uploaded
+/// together in single request result in single reload, done outside of
+/// the request handling. Reloads right away if there is no task for it.
+void scheduleReload();
+
+/// \brief Updates the display, redrawing only areas that changed: 
+/// the background is restored and sprites covering the areas are drawn again
+/// off-screen, then the finished areas are pushed to the display.
+void updatePagesStuff();
+
+}
@@ -1,4 +1,7 @@
 #include "RequestHandler.hpp"
+#include "AssetCache.hpp"
+#include "Renderer.hpp"
+#include "DisplayRefresh.hpp"
 #include <LittleFS.h>
 #include <ctime>
 
@@ -166,7 +169,8 @@ void RequestHandler::upload(ESP8266WebServer& server, const String& uri, HTTPUpl
 				return;
 			}
 
-			if (upload.contentLength > 1024 * 6) {
+			const size_t maxLength = processingType == ProcessingType::Bitmap ? maxBitmapUploadLength : maxUploadLength;
+			if (upload.contentLength > maxLength) {
 				LOG_DEBUG(pages, "Too large");
 				errorCode = 413;
 				return;
@@ -201,6 +205,9 @@ void RequestHandler::upload(ESP8266WebServer& server, const String& uri, HTTPUpl
 			LOG_DEBUG(pages, "Opening '%s' for saving", path.c_str());
 			uploadedFile = LittleFS.open(path.c_str(), "w");
 
+			// Leave more CPU time for receiving and processing
+			DisplayRefresh::setUploading(true);
+
 			if (processingType == ProcessingType::Bitmap) {
 				bitmapProcessor.initialize();
 			}
@@ -226,6 +233,11 @@ void RequestHandler::upload(ESP8266WebServer& server, const String& uri, HTTPUpl
 			
 			uploadedFile.close();
 			uploadedFilesCount += 1;
+			DisplayRefresh::setUploading(false);
+
+			// Decoded frames and resolved assets might be outdated now
+			assetCache.clear();
+			scheduleReload();
 
 			LOG_DEBUG(pages, "Upload saved");
 			break;
@@ -235,6 +247,11 @@ void RequestHandler::upload(ESP8266WebServer& server, const String& uri, HTTPUpl
 			std::string path(uploadedFile.fullName()); // copy to avoid invalidation
 			uploadedFile.close();
 			LittleFS.remove(path.c_str());
+			DisplayRefresh::setUploading(false);
+
+			// Page might have been using the file, overwritten before
+			assetCache.clear();
+			scheduleReload();
 			
 			LOG_DEBUG(pages, "Upload aborted");
 			break;
@@ -13,6 +13,13 @@ class RequestHandler : public ESP8266WebServer::RequestHandlerType {
 	/// by request parsing when selecting right handler, but allow double checking.
 	static constexpr bool ensureHandlerCanHandleRequest = false;
 
+	/// Limit of upload request length, for configuration and other files.
+	static constexpr size_t maxUploadLength = 1024 * 6;
+	/// \brief Limit of upload request length for bitmaps, which are re-encoded
+	/// in chunks as received, so it covers full screen 32 bits (BGRA) source,
+	/// with some room for headers and the request encoding.
+	static constexpr size_t maxBitmapUploadLength = MATRIX_WIDTH * MATRIX_HEIGHT * 4 + 1024;
+
 public:
 	bool canHandle(HTTPMethod requestMethod, const String& requestUri) override {
 		return requestUri.startsWith(F("/pages"));
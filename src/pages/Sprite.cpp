@@ -3,7 +3,7 @@
 namespace pages {
 
 #ifdef NICE_CODE
-uint16_t Sprite::Temperature::interpolateColor(float temperature) {
+uint16_t Sprite::Temperature::interpolateColor(float temperature) const {
 	using namespace colors;
 
 	if (temperature <= referenceValue[0]) {
@@ -19,15 +19,15 @@ uint16_t Sprite::Temperature::interpolateColor(float temperature) {
 		if (temperature <= currentTemperature) {
 			float ratio = (temperature - previousTemperature) 
 				/ (currentTemperature - previousTemperature);
-			return to565(toRGB(interpolateHSL(
-				toHSL(previousColor), toHSL(currentColor), ratio)));
+			return to565(toRGB(interpolateHSL(toFixedHSL(previousColor), 
+				toFixedHSL(currentColor), static_cast<uint16_t>(ratio * 256))));
 		}
 	}
 
 	return targetColors[3]; // last color 
 }
 #else
-uint16_t Sprite::Temperature::interpolateColor(float temperature) {
+uint16_t Sprite::Temperature::interpolateColor(float temperature) const {
 	using namespace colors;
 	static_assert(sizeof(referenceValue) / sizeof(referenceValue[0]) == 3);
 
@@ -47,8 +47,8 @@ uint16_t Sprite::Temperature::interpolateColor(float temperature) {
 
 	float ratio = (temperature - previousTemperature) 
 		/ (currentTemperature - previousTemperature);
-	return to565(toRGB(interpolateHSL(
-		toHSL(previousColor), toHSL(currentColor), ratio)));
+	return to565(toRGB(interpolateHSL(toFixedHSL(previousColor), 
+		toFixedHSL(currentColor), static_cast<uint16_t>(ratio * 256))));
 
 	return targetColors[3]; // last color 
 }
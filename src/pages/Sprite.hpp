@@ -136,7 +136,7 @@ union Sprite {
 		uint8_t x;
 		uint8_t y;
 
-		uint16_t interpolateColor(float temperature);
+		uint16_t interpolateColor(float temperature) const;
 	} temperature;
 	static_assert(sizeof(Temperature) == 24);
 
@@ -144,8 +144,8 @@ union Sprite {
 	struct Image {
 		char path[16];
 		inline void setPath(const char* newPath) {
-			std::strncpy(path, newPath, sizeof(path));
-			path[sizeof(path) - 1] = 0;
+			std::memset(path, 0, sizeof(path));
+			std::memcpy(path, newPath, strnlen(newPath, sizeof(path) - 1));
 		}
 
 		uint16_t transparentColor = 0; // (0 means no transparency)
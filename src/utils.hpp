@@ -37,6 +37,14 @@ constexpr uint8_t numberOfSetBits(uint32_t i)
 }
 
 
+/// FNV1a 32 hash of null-terminated string (iterative, for runtime use).
+constexpr uint32_t fnv1a_32(const char* s, uint32_t hash = 2166136261u) {
+	while (*s) {
+		hash = (hash ^ static_cast<uint8_t>(*s++)) * 16777619u;
+	}
+	return hash;
+}
+
 template <typename T>
 constexpr typename std::enable_if_t<sizeof(T) == 2, T>
 hton(T value) noexcept
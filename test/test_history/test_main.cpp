@@ -0,0 +1,185 @@
+// Host-native tests of history logs, on file system backed by temporary
+// directory: buffered appends, compaction and repairs after power loss.
+//   pio test -e test
+
+#include <unity.h>
+#include "History.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unistd.h> // getpid
+
+using History::Log;
+using History::Record;
+
+namespace {
+
+std::filesystem::path root;
+
+constexpr uint16_t capacity = 20;
+
+Log makeLog() {
+	return Log { "/log", "/log.tmp", capacity };
+}
+
+Record makeRecord(uint32_t time) {
+	Record record {
+		.time = time,
+		.min = static_cast<int16_t>(2000 + time),
+		.avg = static_cast<int16_t>(2100 + time),
+		.max = static_cast<int16_t>(2200 + time),
+		.check = 0,
+	};
+	record.check = record.calculateCheck();
+	return record;
+}
+
+void appendRange(Log& log, uint32_t from, uint32_t to) {
+	for (uint32_t time = from; time < to; time++) {
+		log.append(makeRecord(time));
+	}
+}
+
+std::vector<uint32_t> times(const Log& log) {
+	std::vector<uint32_t> times;
+	log.forEach([&](const Record& record) { times.push_back(record.time); });
+	return times;
+}
+
+void assertTimes(const Log& log, uint32_t from, uint32_t to) {
+	const auto actual = times(log);
+	TEST_ASSERT_EQUAL(to - from, actual.size());
+	for (size_t i = 0; i < actual.size(); i++) {
+		TEST_ASSERT_EQUAL_UINT32(from + i, actual[i]);
+	}
+}
+
+size_t fileSize(const char* path) {
+	File file = LittleFS.open(path, "r");
+	return file ? file.size() : 0;
+}
+
+}
+
+void setUp() {
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+}
+
+void tearDown() {}
+
+void test_append_is_buffered_until_flush() {
+	Log log = makeLog();
+	appendRange(log, 0, 5);
+	TEST_ASSERT_FALSE(LittleFS.exists("/log"));
+	assertTimes(log, 0, 5); // pending records are included
+
+	log.flush();
+	TEST_ASSERT_EQUAL(5 * sizeof(Record), fileSize("/log"));
+	assertTimes(log, 0, 5);
+
+	// Flushed on its own once enough records are pending
+	appendRange(log, 5, 5 + Log::maxPending);
+	TEST_ASSERT_EQUAL(0, log.pendingCount);
+	TEST_ASSERT_EQUAL((5 + Log::maxPending) * sizeof(Record), fileSize("/log"));
+	assertTimes(log, 0, 5 + Log::maxPending);
+}
+
+void test_compact_keeps_last_capacity_records() {
+	Log log = makeLog();
+	appendRange(log, 0, 2 * capacity - 1);
+	log.flush();
+	TEST_ASSERT_EQUAL((2 * capacity - 1) * sizeof(Record), fileSize("/log"));
+
+	// Reaching twice the capacity triggers compaction
+	appendRange(log, 2 * capacity - 1, 2 * capacity);
+	log.flush();
+	TEST_ASSERT_EQUAL(capacity * sizeof(Record), fileSize("/log"));
+	TEST_ASSERT_FALSE(LittleFS.exists("/log.tmp"));
+	assertTimes(log, capacity, 2 * capacity);
+
+	// Log keeps working after compaction
+	appendRange(log, 2 * capacity, 2 * capacity + 5);
+	log.flush();
+	assertTimes(log, capacity, 2 * capacity + 5);
+}
+
+void test_compact_ignores_torn_tail() {
+	Log log = makeLog();
+	appendRange(log, 0, 2 * capacity - 1);
+	log.flush();
+	File file = LittleFS.open("/log", "a");
+	file.write(reinterpret_cast<const uint8_t*>("torn"), 4);
+	file.close();
+
+	appendRange(log, 2 * capacity - 1, 2 * capacity);
+	log.flush();
+	TEST_ASSERT_EQUAL(capacity * sizeof(Record), fileSize("/log"));
+	// Last record is misaligned by the torn one, so it fails the check
+	const auto actual = times(log);
+	TEST_ASSERT_EQUAL(capacity - 1, actual.size());
+	TEST_ASSERT_EQUAL_UINT32(capacity, actual.front());
+}
+
+void test_repair_truncates_torn_record() {
+	Log log = makeLog();
+	appendRange(log, 0, 10);
+	log.flush();
+	File file = LittleFS.open("/log", "a");
+	const Record next = makeRecord(10);
+	file.write(reinterpret_cast<const uint8_t*>(&next), sizeof(Record) / 2); // power lost
+	file.close();
+
+	log.repair();
+	TEST_ASSERT_EQUAL(10 * sizeof(Record), fileSize("/log"));
+	assertTimes(log, 0, 10);
+
+	// Further appends stay aligned
+	appendRange(log, 10, 15);
+	log.flush();
+	assertTimes(log, 0, 15);
+}
+
+void test_repair_finishes_interrupted_compaction() {
+	Log log = makeLog();
+	appendRange(log, 0, 10);
+	log.flush();
+	LittleFS.rename("/log", "/log.tmp"); // as if power was lost after removing the log
+
+	log.repair();
+	TEST_ASSERT_TRUE(LittleFS.exists("/log"));
+	TEST_ASSERT_FALSE(LittleFS.exists("/log.tmp"));
+	assertTimes(log, 0, 10);
+}
+
+void test_corrupted_records_are_skipped() {
+	Log log = makeLog();
+	appendRange(log, 0, 10);
+	log.flush();
+	File file = LittleFS.open("/log", "r+");
+	file.seek(3 * sizeof(Record) + offsetof(Record, avg));
+	file.write(0xFF);
+	file.close();
+
+	const auto actual = times(log);
+	TEST_ASSERT_EQUAL(9, actual.size());
+	TEST_ASSERT_EQUAL_UINT32(2, actual[2]);
+	TEST_ASSERT_EQUAL_UINT32(4, actual[3]);
+}
+
+int main(int argc, char* argv[]) {
+	root = std::filesystem::temp_directory_path() / ("test-history-" + std::to_string(getpid()));
+	LittleFS.setRoot(root.string().c_str());
+
+	UNITY_BEGIN();
+	RUN_TEST(test_append_is_buffered_until_flush);
+	RUN_TEST(test_compact_keeps_last_capacity_records);
+	RUN_TEST(test_compact_ignores_torn_tail);
+	RUN_TEST(test_repair_truncates_torn_record);
+	RUN_TEST(test_repair_finishes_interrupted_compaction);
+	RUN_TEST(test_corrupted_records_are_skipped);
+	const int failures = UNITY_END();
+
+	std::filesystem::remove_all(root);
+	return failures;
+}
@@ -0,0 +1,207 @@
+// Host-native tests of thermometers pipeline, against fake `DallasTemperature`
+// stand-in: filtering, rejecting error values, rescans and conversion timeout.
+//   pio test -e test
+
+#include <unity.h>
+#include "Thermometers.hpp"
+
+namespace {
+
+/// Stand-in for `DallasTemperature`, with sensors reporting set temperatures.
+struct FakeDriver {
+	static constexpr uint8_t maxDevices = 4;
+
+	uint8_t devices = 1;
+	float temperatures[maxDevices] = { 21.0f, 22.0f, 23.0f, 24.0f };
+	bool conversionComplete = true;
+	unsigned begins = 0;
+	unsigned requests = 0;
+	uint8_t resolution = 0;
+
+	void begin() { begins += 1; }
+	void setWaitForConversion(bool) {}
+	void setResolution(uint8_t bits) { resolution = bits; }
+	uint8_t getDeviceCount() { return devices; }
+	bool getAddress(uint8_t* address, uint8_t index) {
+		std::memset(address, 0, 8);
+		address[0] = 0x28; // DS18B20 family
+		address[7] = index;
+		return index < devices;
+	}
+	void requestTemperatures() { requests += 1; }
+	bool isConversionComplete() { return conversionComplete; }
+	float getTempC(const uint8_t* address) { return temperatures[address[7]]; }
+};
+
+using Pipeline = Thermometers::Pipeline<FakeDriver>;
+
+FakeDriver driver;
+
+/// Runs the pipeline at given time, as many times as takes to finish a round.
+void step(Pipeline& pipeline, millis_t now) {
+	for (uint8_t i = 0; i < 4 + Pipeline::maxSensors; i++) {
+		pipeline.update(now);
+	}
+}
+
+Pipeline makePipeline(uint8_t medianWindow = 3, uint16_t emaAlpha = 64) {
+	Pipeline pipeline(driver);
+	Thermometers::Config config;
+	config.medianWindow = medianWindow;
+	config.emaAlpha = emaAlpha;
+	pipeline.configure(config);
+	return pipeline;
+}
+
+}
+
+void setUp() {
+	driver = FakeDriver();
+}
+
+void tearDown() {}
+
+void test_median_rejects_single_spike() {
+	Pipeline pipeline = makePipeline(3, 256); // median only
+	step(pipeline, 0);
+	step(pipeline, 1000);
+	driver.temperatures[0] = 90.0f; // bus glitch
+	step(pipeline, 2000);
+
+	const auto* sensor = pipeline.primary();
+	TEST_ASSERT_NOT_NULL(sensor);
+	TEST_ASSERT_EQUAL_FLOAT(90.0f, sensor->last);
+	TEST_ASSERT_EQUAL_FLOAT(21.0f, sensor->value());
+
+	driver.temperatures[0] = 21.0f;
+	step(pipeline, 3000);
+	TEST_ASSERT_EQUAL_FLOAT(21.0f, sensor->value());
+	TEST_ASSERT_EQUAL_UINT32(4, sensor->readings);
+}
+
+void test_median_follows_lasting_change() {
+	Pipeline pipeline = makePipeline(3, 256);
+	step(pipeline, 0);
+	driver.temperatures[0] = 25.0f;
+	step(pipeline, 1000);
+	step(pipeline, 2000);
+	TEST_ASSERT_EQUAL_FLOAT(25.0f, pipeline.primary()->value());
+}
+
+void test_ema_smooths_readings() {
+	Pipeline pipeline = makePipeline(1, 64); // average only
+	driver.temperatures[0] = 20.0f;
+	step(pipeline, 0);
+	TEST_ASSERT_EQUAL_FLOAT(20.0f, pipeline.primary()->value()); // first value taken as is
+	driver.temperatures[0] = 24.0f;
+	step(pipeline, 1000);
+	TEST_ASSERT_EQUAL_FLOAT(21.0f, pipeline.primary()->value());
+	step(pipeline, 2000);
+	TEST_ASSERT_EQUAL_FLOAT(21.75f, pipeline.primary()->value());
+}
+
+void test_disconnected_value_is_error() {
+	Pipeline pipeline = makePipeline();
+	driver.temperatures[0] = Pipeline::disconnectedValue;
+	step(pipeline, 0);
+
+	TEST_ASSERT_NULL(pipeline.primary());
+	const auto& sensor = *pipeline.begin();
+	TEST_ASSERT_EQUAL_UINT32(1, sensor.errors);
+	TEST_ASSERT_EQUAL_UINT32(0, sensor.readings);
+}
+
+void test_power_on_value_is_error_only_before_first_reading() {
+	Pipeline pipeline = makePipeline(1, 256);
+	driver.temperatures[0] = Pipeline::powerOnValue;
+	step(pipeline, 0);
+	TEST_ASSERT_NULL(pipeline.primary());
+	TEST_ASSERT_EQUAL_UINT32(1, pipeline.begin()->errors);
+
+	driver.temperatures[0] = 21.0f;
+	step(pipeline, 1000);
+	driver.temperatures[0] = Pipeline::powerOnValue; // could be real temperature now
+	step(pipeline, 2000);
+	const auto* sensor = pipeline.primary();
+	TEST_ASSERT_NOT_NULL(sensor);
+	TEST_ASSERT_EQUAL_UINT32(2, sensor->readings);
+	TEST_ASSERT_EQUAL_UINT32(1, sensor->errors);
+	TEST_ASSERT_EQUAL_FLOAT(Pipeline::powerOnValue, sensor->value());
+}
+
+void test_errors_of_one_sensor_keep_others() {
+	driver.devices = 2;
+	Pipeline pipeline = makePipeline();
+	driver.temperatures[0] = Pipeline::disconnectedValue;
+	for (uint8_t i = 0; i <= Pipeline::maxFailedRounds; i++) {
+		step(pipeline, i * 1000);
+	}
+	TEST_ASSERT_EQUAL(1, driver.begins); // no rescan, as the other sensor works
+	const auto* sensor = pipeline.primary();
+	TEST_ASSERT_NOT_NULL(sensor);
+	TEST_ASSERT_EQUAL_FLOAT(22.0f, sensor->value());
+}
+
+void test_rescan_after_failed_rounds() {
+	Pipeline pipeline = makePipeline();
+	driver.temperatures[0] = Pipeline::disconnectedValue;
+	for (uint8_t i = 0; i < Pipeline::maxFailedRounds - 1; i++) {
+		step(pipeline, i * 1000);
+	}
+	TEST_ASSERT_EQUAL(1, driver.begins);
+
+	step(pipeline, (Pipeline::maxFailedRounds - 1) * 1000);
+	TEST_ASSERT_EQUAL(2, driver.begins);
+	TEST_ASSERT_EQUAL(Pipeline::maxFailedRounds + 1, driver.requests); // conversions go on
+	TEST_ASSERT_EQUAL_UINT32(1, pipeline.begin()->errors); // counted from the rescan
+}
+
+void test_rescan_when_no_sensors() {
+	driver.devices = 0;
+	Pipeline pipeline = makePipeline();
+	step(pipeline, 0);
+	TEST_ASSERT_EQUAL(1, driver.begins);
+	TEST_ASSERT_TRUE(pipeline.begin() == pipeline.end());
+
+	step(pipeline, Pipeline::rescanInterval - 1);
+	TEST_ASSERT_EQUAL(1, driver.begins);
+
+	driver.devices = 1;
+	step(pipeline, Pipeline::rescanInterval);
+	TEST_ASSERT_EQUAL(2, driver.begins);
+	TEST_ASSERT_NOT_NULL(pipeline.primary());
+}
+
+void test_conversion_timeout() {
+	Pipeline pipeline = makePipeline();
+	driver.conversionComplete = false; // i.e. parasite powered, can't be polled
+	step(pipeline, 0);
+	TEST_ASSERT_EQUAL(1, driver.requests);
+	TEST_ASSERT_EQUAL(12, driver.resolution);
+	step(pipeline, 799);
+	TEST_ASSERT_EQUAL_UINT32(0, pipeline.begin()->readings);
+
+	step(pipeline, 800); // 750 ms conversion for 12 bits, and 50 ms margin
+	TEST_ASSERT_EQUAL_UINT32(1, pipeline.begin()->readings);
+	TEST_ASSERT_NOT_NULL(pipeline.primary());
+
+	// Next conversion starts after the interval from previous one
+	step(pipeline, 999);
+	TEST_ASSERT_EQUAL(1, driver.requests);
+	step(pipeline, 1000);
+	TEST_ASSERT_EQUAL(2, driver.requests);
+}
+
+int main(int argc, char* argv[]) {
+	UNITY_BEGIN();
+	RUN_TEST(test_median_rejects_single_spike);
+	RUN_TEST(test_median_follows_lasting_change);
+	RUN_TEST(test_ema_smooths_readings);
+	RUN_TEST(test_disconnected_value_is_error);
+	RUN_TEST(test_power_on_value_is_error_only_before_first_reading);
+	RUN_TEST(test_errors_of_one_sensor_keep_others);
+	RUN_TEST(test_rescan_after_failed_rounds);
+	RUN_TEST(test_rescan_when_no_sensors);
+	RUN_TEST(test_conversion_timeout);
+	return UNITY_END();
+}